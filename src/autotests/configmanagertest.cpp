@@ -0,0 +1,129 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "core/configmanager.h"
+
+#include <QStandardPaths>
+#include <QtTest>
+
+class ConfigManagerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void matchesExactOrigin();
+    void matchesParentHosts();
+    void matchesRegistrableDomain();
+    void portsAndAddresses();
+    void firstServiceWinsSharedSite();
+    void rebuildsOnUpdateAndRemove();
+
+private:
+    static QVariantMap service(const QString &id, const QString &url);
+};
+
+QVariantMap ConfigManagerTest::service(const QString &id, const QString &url)
+{
+    return {{QStringLiteral("id"), id},
+            {QStringLiteral("title"), id},
+            {QStringLiteral("url"), url},
+            {QStringLiteral("workspace"), QStringLiteral("Personal")}};
+}
+
+void ConfigManagerTest::initTestCase()
+{
+    // Keeps QSettings away from the real configuration
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void ConfigManagerTest::init()
+{
+    QSettings(QStringLiteral("io.github.denysmb"), QStringLiteral("unify")).clear();
+}
+
+void ConfigManagerTest::matchesExactOrigin()
+{
+    ConfigManager config;
+    config.setServices({service(QStringLiteral("app"), QStringLiteral("https://app.example.com/inbox")),
+                        service(QStringLiteral("admin"), QStringLiteral("https://app.example.com:8443/"))});
+
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://app.example.com"))), QStringLiteral("app"));
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://app.example.com:8443"))), QStringLiteral("admin"));
+    // Another scheme is not the same origin; the host is still the first service's
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("http://app.example.com"))), QStringLiteral("app"));
+}
+
+void ConfigManagerTest::matchesParentHosts()
+{
+    ConfigManager config;
+    config.setServices({service(QStringLiteral("site"), QStringLiteral("https://www.example.com/")),
+                        service(QStringLiteral("web"), QStringLiteral("https://web.example.com/")),
+                        service(QStringLiteral("root"), QStringLiteral("https://example.com/"))});
+
+    // The closest configured host wins over the registrable domain
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://chat.web.example.com"))), QStringLiteral("web"));
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://static.example.com"))), QStringLiteral("root"));
+}
+
+void ConfigManagerTest::matchesRegistrableDomain()
+{
+    ConfigManager config;
+    config.setServices({service(QStringLiteral("mail"), QStringLiteral("https://mail.example.co.uk/")),
+                        service(QStringLiteral("blog"), QStringLiteral("https://blog.github.io/"))});
+
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://login.example.co.uk"))), QStringLiteral("mail"));
+    // github.io is a public suffix, so another user's pages are another site
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://other.github.io"))), QString());
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://example.com"))), QString());
+    QCOMPARE(config.serviceIdForOrigin(QUrl()), QString());
+}
+
+void ConfigManagerTest::portsAndAddresses()
+{
+    ConfigManager config;
+    config.setServices({service(QStringLiteral("dev"), QStringLiteral("http://localhost:3000/")),
+                        service(QStringLiteral("nas"), QStringLiteral("http://192.168.1.10:5000/")),
+                        service(QStringLiteral("app"), QStringLiteral("https://app.example.com/"))});
+
+    // Another port on a configured host falls back to the host
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://app.example.com:9000"))), QStringLiteral("app"));
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("http://localhost:4000"))), QStringLiteral("dev"));
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("http://192.168.1.10"))), QStringLiteral("nas"));
+    // An address has no registrable domain, so a neighbour matches nothing
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("http://192.168.1.11:5000"))), QString());
+}
+
+void ConfigManagerTest::firstServiceWinsSharedSite()
+{
+    ConfigManager config;
+    config.setServices({service(QStringLiteral("gmail"), QStringLiteral("https://mail.google.com/")),
+                        service(QStringLiteral("calendar"), QStringLiteral("https://calendar.google.com/")),
+                        service(QStringLiteral("gmail-work"), QStringLiteral("https://mail.google.com/mail/u/1/"))});
+
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://calendar.google.com"))), QStringLiteral("calendar"));
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://mail.google.com"))), QStringLiteral("gmail"));
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://accounts.google.com"))), QStringLiteral("gmail"));
+}
+
+void ConfigManagerTest::rebuildsOnUpdateAndRemove()
+{
+    ConfigManager config;
+    config.setServices({service(QStringLiteral("gmail"), QStringLiteral("https://mail.google.com/")),
+                        service(QStringLiteral("calendar"), QStringLiteral("https://calendar.google.com/"))});
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://accounts.google.com"))), QStringLiteral("gmail"));
+
+    config.updateService(QStringLiteral("gmail"), service(QStringLiteral("gmail"), QStringLiteral("https://mail.proton.me/")));
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://accounts.google.com"))), QStringLiteral("calendar"));
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://account.proton.me"))), QStringLiteral("gmail"));
+
+    config.removeService(QStringLiteral("calendar"));
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://accounts.google.com"))), QString());
+
+    config.addService(service(QStringLiteral("drive"), QStringLiteral("https://drive.google.com/")));
+    QCOMPARE(config.serviceIdForOrigin(QUrl(QStringLiteral("https://accounts.google.com"))), QStringLiteral("drive"));
+}
+
+QTEST_GUILESS_MAIN(ConfigManagerTest)
+#include "configmanagertest.moc"
@@ -0,0 +1,141 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "utils/crx3payloaddevice.h"
+
+#include <KZip>
+#include <QBuffer>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <QtTest>
+
+class Crx3PayloadDeviceTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void readsZipInPlace();
+    void seeksWithinPayload();
+    void rejectsMalformedFiles_data();
+    void rejectsMalformedFiles();
+    void isReadOnly();
+
+private:
+    static QByteArray zipArchive();
+    static QByteArray preamble(quint32 version, quint32 headerLength);
+    QString writeFile(const QString &name, const QByteArray &data) const;
+
+    QTemporaryDir m_dir;
+};
+
+void Crx3PayloadDeviceTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+QByteArray Crx3PayloadDeviceTest::zipArchive()
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    KZip zip(&buffer);
+    zip.open(QIODevice::WriteOnly);
+    zip.writeFile(QStringLiteral("manifest.json"), QByteArray("{\"version\": \"4.10.2830.0\"}"));
+    zip.writeFile(QStringLiteral("_platform_specific/linux_x64/libwidevinecdm.so"), QByteArray(64 * 1024, 'w'));
+    zip.close();
+    return data;
+}
+
+QByteArray Crx3PayloadDeviceTest::preamble(quint32 version, quint32 headerLength)
+{
+    QByteArray data("Cr24");
+    data.resize(12);
+    qToLittleEndian<quint32>(version, data.data() + 4);
+    qToLittleEndian<quint32>(headerLength, data.data() + 8);
+    return data;
+}
+
+QString Crx3PayloadDeviceTest::writeFile(const QString &name, const QByteArray &data) const
+{
+    const QString path = m_dir.filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        return QString();
+    }
+    return path;
+}
+
+void Crx3PayloadDeviceTest::readsZipInPlace()
+{
+    // The real header is a signed protobuf; its contents don't matter here
+    const QByteArray header(300, '\x5a');
+    const QByteArray zip = zipArchive();
+    const QString path = writeFile(QStringLiteral("valid.crx"), preamble(3, header.size()) + header + zip);
+
+    Crx3PayloadDevice payload(path);
+    QVERIFY2(payload.open(QIODevice::ReadOnly), qPrintable(payload.errorString()));
+    QCOMPARE(payload.payloadOffset(), qint64(12 + header.size()));
+    QCOMPARE(payload.size(), qint64(zip.size()));
+    QCOMPARE(payload.readAll(), zip);
+
+    QVERIFY(payload.seek(0));
+    KZip archive(&payload);
+    QVERIFY(archive.open(QIODevice::ReadOnly));
+    const KArchiveFile *lib = archive.directory()->file(QStringLiteral("_platform_specific/linux_x64/libwidevinecdm.so"));
+    QVERIFY(lib);
+    QCOMPARE(lib->data(), QByteArray(64 * 1024, 'w'));
+    QVERIFY(archive.directory()->file(QStringLiteral("manifest.json")));
+    archive.close();
+}
+
+void Crx3PayloadDeviceTest::seeksWithinPayload()
+{
+    const QByteArray zip = zipArchive();
+    const QString path = writeFile(QStringLiteral("seek.crx"), preamble(3, 0) + zip);
+
+    Crx3PayloadDevice payload(path);
+    QVERIFY(payload.open(QIODevice::ReadOnly));
+    QVERIFY(payload.seek(zip.size() - 8));
+    QCOMPARE(payload.read(100), zip.right(8));
+    QVERIFY(payload.atEnd());
+    QVERIFY(payload.seek(2));
+    QCOMPARE(payload.read(2), QByteArray("\x03\x04", 2));
+    QVERIFY(!payload.seek(zip.size() + 1));
+    QVERIFY(!payload.seek(-1));
+}
+
+void Crx3PayloadDeviceTest::rejectsMalformedFiles_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    const QByteArray zip = zipArchive();
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("bare zip") << zip;
+    QTest::newRow("crx2") << preamble(2, 0) + zip;
+    QTest::newRow("header past end") << preamble(3, zip.size() + 1) + zip;
+    QTest::newRow("header misses zip") << preamble(3, 4) + zip;
+    QTest::newRow("truncated preamble") << preamble(3, 0).left(8);
+}
+
+void Crx3PayloadDeviceTest::rejectsMalformedFiles()
+{
+    QFETCH(QByteArray, data);
+    const QString path = writeFile(QStringLiteral("bad.crx"), data);
+
+    Crx3PayloadDevice payload(path);
+    QVERIFY(!payload.open(QIODevice::ReadOnly));
+    QVERIFY(!payload.errorString().isEmpty());
+    QVERIFY(!payload.isOpen());
+}
+
+void Crx3PayloadDeviceTest::isReadOnly()
+{
+    const QString path = writeFile(QStringLiteral("readonly.crx"), preamble(3, 0) + zipArchive());
+
+    Crx3PayloadDevice payload(path);
+    QVERIFY(!payload.open(QIODevice::ReadWrite));
+    QVERIFY(!Crx3PayloadDevice(m_dir.filePath(QStringLiteral("missing.crx"))).open(QIODevice::ReadOnly));
+}
+
+QTEST_MAIN(Crx3PayloadDeviceTest)
+#include "crx3payloaddevicetest.moc"
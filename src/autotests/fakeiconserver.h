@@ -0,0 +1,180 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Local stand-in for the favicon endpoints FaviconCache talks to, shared by
+// faviconcachetest and faviconcachebench. Point the cache at it with
+// setEndpointsForTesting(googleTemplate(), iconHorseTemplate()); every GET is
+// answered with a small PNG, distinct per path, unless a fault was injected
+// for that path. HTTP/1.1 keep-alive, runs on the thread it was created on.
+
+#ifndef FAKEICONSERVER_H
+#define FAKEICONSERVER_H
+
+#include <QBuffer>
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QPointer>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+class FakeIconServer
+{
+public:
+    enum Fault {
+        NoFault,
+        NotFound, // 404 with an empty body
+        Hang, // headers never sent, the client has to time out
+        TruncatedBody, // 200 with the first half of the PNG
+    };
+
+    FakeIconServer()
+    {
+        QObject::connect(&m_server, &QTcpServer::newConnection, &m_server, [this]() {
+            while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+                serve(socket);
+            }
+        });
+    }
+
+    bool listen()
+    {
+        return m_server.listen(QHostAddress::LocalHost);
+    }
+
+    QString baseUrl() const
+    {
+        return QStringLiteral("http://127.0.0.1:") + QString::number(m_server.serverPort());
+    }
+
+    QString googleTemplate() const
+    {
+        return baseUrl() + QStringLiteral("/google/%1");
+    }
+
+    QString iconHorseTemplate() const
+    {
+        return baseUrl() + QStringLiteral("/iconhorse/%1");
+    }
+
+    // path as requested, e.g. "/google/chat.example.com"
+    void setFault(const QString &path, Fault fault)
+    {
+        m_faults.insert(path, fault);
+    }
+
+    // Held back before answering, so concurrent requests overlap
+    void setResponseDelay(int msecs)
+    {
+        m_delayMs = msecs;
+    }
+
+    // Also drops connections left over from earlier clients
+    void reset()
+    {
+        for (const QPointer<QTcpSocket> &socket : std::as_const(m_sockets)) {
+            if (socket) {
+                socket->disconnect();
+                socket->abort();
+                socket->deleteLater();
+            }
+        }
+        m_sockets.clear();
+        m_faults.clear();
+        m_requests.clear();
+        m_delayMs = 0;
+        m_inFlight = 0;
+        m_maxInFlight = 0;
+    }
+
+    // Request paths in arrival order
+    QStringList requests() const
+    {
+        return m_requests;
+    }
+
+    int maxConcurrentRequests() const
+    {
+        return m_maxInFlight;
+    }
+
+private:
+    void serve(QTcpSocket *socket)
+    {
+        m_sockets.append(socket);
+        auto buffer = std::make_shared<QByteArray>();
+        // Requests received on this connection and not answered yet
+        auto pending = std::make_shared<int>(0);
+        QObject::connect(socket, &QTcpSocket::disconnected, socket, [this, socket, pending]() {
+            m_inFlight -= *pending;
+            socket->deleteLater();
+        });
+        QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket, buffer, pending]() {
+            buffer->append(socket->readAll());
+            for (;;) {
+                const qsizetype headerEnd = buffer->indexOf("\r\n\r\n");
+                if (headerEnd < 0) {
+                    return;
+                }
+                // "GET /path HTTP/1.1"; favicon requests carry no body
+                const QList<QByteArray> requestLine = buffer->left(buffer->indexOf("\r\n")).split(' ');
+                buffer->remove(0, headerEnd + 4);
+                const QString path = requestLine.size() > 1 ? QString::fromLatin1(requestLine.at(1)) : QString();
+
+                m_requests.append(path);
+                ++*pending;
+                m_maxInFlight = std::max(m_maxInFlight, ++m_inFlight);
+                QTimer::singleShot(m_delayMs, socket, [this, socket, pending, path]() {
+                    respond(socket, path, pending);
+                });
+            }
+        });
+    }
+
+    void respond(QTcpSocket *socket, const QString &path, const std::shared_ptr<int> &pending)
+    {
+        const Fault fault = m_faults.value(path, NoFault);
+        if (fault == Hang) {
+            return;
+        }
+        --*pending;
+        --m_inFlight;
+
+        if (fault == NotFound) {
+            socket->write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+            return;
+        }
+        QByteArray body = png(path);
+        if (fault == TruncatedBody) {
+            body.truncate(body.size() / 2);
+        }
+        socket->write("HTTP/1.1 200 OK\r\nContent-Type: image/png\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\n\r\n" + body);
+    }
+
+    static QByteArray png(const QString &path)
+    {
+        QImage image(16, 16, QImage::Format_RGB32);
+        image.fill(QColor::fromRgb(QRgb(qHash(path) & 0xffffff)));
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "PNG");
+        return data;
+    }
+
+    QTcpServer m_server;
+    QList<QPointer<QTcpSocket>> m_sockets;
+    QHash<QString, Fault> m_faults;
+    QStringList m_requests;
+    int m_delayMs = 0;
+    int m_inFlight = 0;
+    int m_maxInFlight = 0;
+};
+
+#endif // FAKEICONSERVER_H
@@ -0,0 +1,132 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Benchmark for FaviconCache against the in-process FakeIconServer. Reports
+// cold lookups (download, decode, write) for N hosts, warm lookups served from
+// the in-memory index, and the startup prefetch: a fresh instance scanning the
+// populated cache and answering the N lookups queued before its index loaded.
+// Uses the QStandardPaths test locations, never the user's cache.
+//
+//   faviconcachebench --hosts 1000
+
+#include "fakeiconserver.h"
+#include "utils/faviconcache.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+QString serviceUrl(int index)
+{
+    return QStringLiteral("https://host%1.example.org/").arg(index);
+}
+
+std::unique_ptr<FaviconCache> createCache(const FakeIconServer &server)
+{
+    auto cache = std::make_unique<FaviconCache>();
+    cache->setEndpointsForTesting(server.googleTemplate(), server.iconHorseTemplate());
+    return cache;
+}
+
+// Asks for every host's favicon and spins until all of them were announced,
+// returning how many were
+int requestAll(FaviconCache &cache, int hosts)
+{
+    int received = 0;
+    QEventLoop loop;
+    QObject::connect(&cache, &FaviconCache::faviconReady, &loop, [&received, &loop, hosts]() {
+        if (++received == hosts) {
+            loop.quit();
+        }
+    });
+    QTimer::singleShot(std::chrono::minutes(5), &loop, [&loop]() {
+        std::fprintf(stderr, "timed out\n");
+        loop.quit();
+    });
+
+    for (int i = 0; i < hosts; ++i) {
+        cache.getFavicon(serviceUrl(i), true);
+    }
+    if (received < hosts) {
+        loop.exec();
+    }
+    return received;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("FaviconCache benchmark against a local fake icon server"));
+    parser.addHelpOption();
+    const QCommandLineOption hostsOption(QStringLiteral("hosts"), QStringLiteral("Number of distinct service hosts."), QStringLiteral("n"), QStringLiteral("1000"));
+    parser.addOption(hostsOption);
+    parser.process(app);
+
+    const int hosts = std::max(1, parser.value(hostsOption).toInt());
+
+    QStandardPaths::setTestModeEnabled(true);
+    QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).removeRecursively();
+
+    FakeIconServer server;
+    if (!server.listen()) {
+        std::fprintf(stderr, "failed to start the fake icon server\n");
+        return 1;
+    }
+
+    QElapsedTimer clock;
+    auto cache = createCache(server);
+
+    clock.start();
+    const int cold = requestAll(*cache, hosts);
+    const double coldMs = clock.nsecsElapsed() / 1e6;
+
+    int warm = 0;
+    clock.restart();
+    for (int i = 0; i < hosts; ++i) {
+        if (!cache->getFavicon(serviceUrl(i), true).isEmpty()) {
+            ++warm;
+        }
+    }
+    const double warmUs = clock.nsecsElapsed() / 1e3;
+
+    // Index write and any evictions land before the next instance scans
+    cache.reset();
+    QThreadPool::globalInstance()->waitForDone();
+    const qsizetype requestsBeforeRestart = server.requests().size();
+
+    clock.restart();
+    cache = createCache(server);
+    const int prefetched = requestAll(*cache, hosts);
+    const double startupMs = clock.nsecsElapsed() / 1e6;
+    const qsizetype refetched = server.requests().size() - requestsBeforeRestart;
+
+    const QVariantMap stats = cache->cacheStats();
+    cache.reset();
+    QThreadPool::globalInstance()->waitForDone();
+
+    std::printf("hosts             %d\n", hosts);
+    std::printf("cold lookups      %.1f ms total, %.3f ms per host (%d of %d ready)\n", coldMs, coldMs / hosts, cold, hosts);
+    std::printf("warm lookups      %.2f us per host (%d of %d hit)\n", warmUs / hosts, warm, hosts);
+    std::printf("startup prefetch  %.1f ms until all ready (%d of %d, %lld refetched)\n",
+                startupMs,
+                prefetched,
+                hosts,
+                static_cast<long long>(refetched));
+    std::printf("max concurrent    %d requests\n", server.maxConcurrentRequests());
+    std::printf("disk              %d entries, %.1f KiB\n", stats.value(QStringLiteral("entries")).toInt(), stats.value(QStringLiteral("bytes")).toLongLong() / 1024.0);
+
+    return cold == hosts && warm == hosts && prefetched == hosts && refetched == 0 ? 0 : 1;
+}
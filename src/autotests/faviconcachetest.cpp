@@ -0,0 +1,323 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "fakeiconserver.h"
+#include "utils/faviconcache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QQmlEngine>
+#include <QQuickImageProvider>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QtTest>
+
+#include <memory>
+
+namespace
+{
+// Short enough to keep the hang cases fast, long enough for a loaded CI box
+constexpr int TRANSFER_TIMEOUT_MS = 500;
+
+QString serviceUrl(const QString &host)
+{
+    return QStringLiteral("https://") + host + QLatin1Char('/');
+}
+
+// Stands in for QtWebEngine's image://favicon provider; the test decides when
+// the icon arrives
+class PageIconResponse : public QQuickImageResponse
+{
+public:
+    explicit PageIconResponse(const QImage &image)
+        : m_image(image)
+    {
+    }
+
+    QQuickTextureFactory *textureFactory() const override
+    {
+        return QQuickTextureFactory::textureFactoryForImage(m_image);
+    }
+
+    void finish()
+    {
+        Q_EMIT finished();
+    }
+
+private:
+    QImage m_image;
+};
+
+class PageIconProvider : public QQuickAsyncImageProvider
+{
+public:
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override
+    {
+        Q_UNUSED(id)
+        Q_UNUSED(requestedSize)
+        QImage image(64, 64, QImage::Format_ARGB32);
+        image.fill(qRgb(40, 120, 200));
+        lastResponse = new PageIconResponse(image);
+        return lastResponse;
+    }
+
+    QPointer<PageIconResponse> lastResponse;
+};
+}
+
+class FaviconCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void downloadsOnceThenServesFromCache();
+    void redownloadsAfterEviction();
+    void storesPageIconCapturedBeforeScan();
+    void fallsBackToRootDomain_data();
+    void fallsBackToRootDomain();
+    void iconHorseFallsBackToRootDomain();
+    void backsOffAfterFailures();
+    void discardsTruncatedImages();
+    void capsConcurrentDownloads();
+    void timedOutDownloadsFreeTheirSlot();
+
+private:
+    std::unique_ptr<FaviconCache> createCache() const;
+
+    FakeIconServer m_server;
+};
+
+void FaviconCacheTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_server.listen());
+}
+
+void FaviconCacheTest::init()
+{
+    QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).removeRecursively();
+    m_server.reset();
+}
+
+void FaviconCacheTest::cleanup()
+{
+    // Index writes and file removals from the cache just destroyed
+    QThreadPool::globalInstance()->waitForDone();
+}
+
+std::unique_ptr<FaviconCache> FaviconCacheTest::createCache() const
+{
+    auto cache = std::make_unique<FaviconCache>();
+    cache->setEndpointsForTesting(m_server.googleTemplate(), m_server.iconHorseTemplate());
+    cache->setTransferTimeoutForTesting(TRANSFER_TIMEOUT_MS);
+    return cache;
+}
+
+void FaviconCacheTest::downloadsOnceThenServesFromCache()
+{
+    auto cache = createCache();
+    QSignalSpy ready(cache.get(), &FaviconCache::faviconReady);
+
+    const QString service = serviceUrl(QStringLiteral("chat.example.com"));
+    QVERIFY(cache->getFavicon(service, true).isEmpty());
+    QVERIFY(ready.wait(5000));
+    QCOMPARE(ready.first().at(0).toString(), service);
+    const QString url = ready.first().at(1).toString();
+    QVERIFY2(url.startsWith(QStringLiteral("image://serviceicon/google/chat.example.com?v=")), qPrintable(url));
+
+    QCOMPARE(cache->getFavicon(service, true), url);
+    QCOMPARE(m_server.requests(), QStringList{QStringLiteral("/google/chat.example.com")});
+    const QVariantMap stats = cache->cacheStats();
+    QCOMPARE(stats.value(QStringLiteral("entries")).toInt(), 1);
+    QCOMPARE(stats.value(QStringLiteral("hits")).toLongLong(), qint64(1));
+    QCOMPARE(stats.value(QStringLiteral("misses")).toLongLong(), qint64(1));
+
+    // A new instance finds it on disk, without asking the server again
+    cache.reset();
+    QThreadPool::globalInstance()->waitForDone();
+    cache = createCache();
+    QSignalSpy reloaded(cache.get(), &FaviconCache::faviconReady);
+    QVERIFY(cache->getFavicon(service, true).isEmpty());
+    QVERIFY(reloaded.wait(5000));
+    QCOMPARE(reloaded.first().at(1).toString(), url);
+    QCOMPARE(m_server.requests().size(), 1);
+}
+
+void FaviconCacheTest::redownloadsAfterEviction()
+{
+    auto cache = createCache();
+    QSignalSpy ready(cache.get(), &FaviconCache::faviconReady);
+    const QString service = serviceUrl(QStringLiteral("chat.example.com"));
+    cache->getFavicon(service, true);
+    QVERIFY(ready.wait(5000));
+
+    // Everything goes at the next maintenance run
+    cache->setDiskBudget(1);
+    QTRY_COMPARE_WITH_TIMEOUT(cache->cacheStats().value(QStringLiteral("entries")).toInt(), 0, 5000);
+    cache->setDiskBudget(1024 * 1024);
+
+    // Same host, same bytes: the new link and its blob must both stay
+    QVERIFY(cache->getFavicon(service, true).isEmpty());
+    QVERIFY(ready.wait(5000));
+    QTest::qWait(100);
+    const QString name = QString::fromLatin1(QCryptographicHash::hash("chat.example.com", QCryptographicHash::Md5).toHex());
+    const QFileInfo link(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/icons/favicons/google/") + name
+                         + QStringLiteral(".png"));
+    QVERIFY(link.isSymLink());
+    QVERIFY2(link.exists(), qPrintable(link.symLinkTarget()));
+    QCOMPARE(cache->cacheStats().value(QStringLiteral("entries")).toInt(), 1);
+    QCOMPARE(m_server.requests().size(), 2);
+}
+
+void FaviconCacheTest::storesPageIconCapturedBeforeScan()
+{
+    QQmlEngine engine;
+    auto *provider = new PageIconProvider;
+    engine.addImageProvider(QStringLiteral("favicon"), provider);
+
+    auto cache = createCache();
+    cache->registerImageProvider(&engine);
+    QSignalSpy ready(cache.get(), &FaviconCache::faviconReady);
+
+    // No event loop has run yet, so the startup scan has not been applied
+    const QString service = serviceUrl(QStringLiteral("chat.example.com"));
+    cache->capturePageIcon(service, QUrl(QStringLiteral("https://chat.example.com/inbox")), QUrl(QStringLiteral("image://favicon/chat.example.com/icon.png")));
+    QVERIFY(provider->lastResponse);
+    provider->lastResponse->finish();
+    QCOMPARE(cache->cacheStats().value(QStringLiteral("entries")).toInt(), 0);
+
+    QVERIFY(ready.wait(5000));
+    QVERIFY2(ready.first().at(1).toString().startsWith(QStringLiteral("image://serviceicon/page/chat.example.com?v=")), qPrintable(ready.first().at(1).toString()));
+    const QString name = QString::fromLatin1(QCryptographicHash::hash("chat.example.com", QCryptographicHash::Md5).toHex());
+    const QFileInfo link(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/icons/favicons/page/") + name
+                         + QStringLiteral(".png"));
+    QVERIFY(link.isSymLink());
+    QVERIFY2(link.exists(), qPrintable(link.symLinkTarget()));
+    QVERIFY(m_server.requests().isEmpty());
+}
+
+void FaviconCacheTest::fallsBackToRootDomain_data()
+{
+    QTest::addColumn<int>("fault");
+
+    QTest::newRow("404") << int(FakeIconServer::NotFound);
+    QTest::newRow("timeout") << int(FakeIconServer::Hang);
+    QTest::newRow("truncated body") << int(FakeIconServer::TruncatedBody);
+}
+
+void FaviconCacheTest::fallsBackToRootDomain()
+{
+    QFETCH(int, fault);
+    m_server.setFault(QStringLiteral("/google/mail.example.co.uk"), FakeIconServer::Fault(fault));
+
+    auto cache = createCache();
+    QSignalSpy ready(cache.get(), &FaviconCache::faviconReady);
+    cache->getFavicon(serviceUrl(QStringLiteral("mail.example.co.uk")), true);
+    QVERIFY(ready.wait(5000));
+
+    // Root domain by the public suffix list, not the last two labels
+    QCOMPARE(m_server.requests(), (QStringList{QStringLiteral("/google/mail.example.co.uk"), QStringLiteral("/google/example.co.uk")}));
+    // Stored for the subdomain that asked
+    QVERIFY(ready.first().at(1).toString().startsWith(QStringLiteral("image://serviceicon/google/mail.example.co.uk?v=")));
+    QCOMPARE(cache->cacheStats().value(QStringLiteral("backedOff")).toInt(), 1);
+}
+
+void FaviconCacheTest::iconHorseFallsBackToRootDomain()
+{
+    m_server.setFault(QStringLiteral("/iconhorse/web.example.com"), FakeIconServer::NotFound);
+
+    auto cache = createCache();
+    QSignalSpy ready(cache.get(), &FaviconCache::faviconSourceReady);
+    cache->fetchFaviconFromSource(serviceUrl(QStringLiteral("web.example.com")), FaviconCache::IconHorseSource);
+    QVERIFY(ready.wait(5000));
+
+    QCOMPARE(ready.first().at(1).toInt(), int(FaviconCache::IconHorseSource));
+    QCOMPARE(m_server.requests(), (QStringList{QStringLiteral("/iconhorse/web.example.com"), QStringLiteral("/iconhorse/example.com")}));
+}
+
+void FaviconCacheTest::backsOffAfterFailures()
+{
+    m_server.setFault(QStringLiteral("/google/chat.example.com"), FakeIconServer::NotFound);
+    m_server.setFault(QStringLiteral("/google/example.com"), FakeIconServer::NotFound);
+
+    auto cache = createCache();
+    QSignalSpy ready(cache.get(), &FaviconCache::faviconReady);
+    const QString service = serviceUrl(QStringLiteral("chat.example.com"));
+    cache->getFavicon(service, true);
+    QTRY_COMPARE_WITH_TIMEOUT(cache->cacheStats().value(QStringLiteral("backedOff")).toInt(), 2, 5000);
+    QCOMPARE(m_server.requests().size(), 2);
+
+    // Both URLs are known dead: nothing goes out until the backoff expires
+    QVERIFY(cache->getFavicon(service, true).isEmpty());
+    cache->fetchFaviconFromSource(service, FaviconCache::GoogleSource);
+    QTest::qWait(200);
+    QCOMPARE(m_server.requests().size(), 2);
+    QCOMPARE(ready.count(), 0);
+
+    // ...and that survives a restart
+    cache.reset();
+    QThreadPool::globalInstance()->waitForDone();
+    cache = createCache();
+    cache->getFavicon(service, true);
+    QTRY_COMPARE_WITH_TIMEOUT(cache->cacheStats().value(QStringLiteral("backedOff")).toInt(), 2, 5000);
+    QTest::qWait(200);
+    QCOMPARE(m_server.requests().size(), 2);
+}
+
+void FaviconCacheTest::discardsTruncatedImages()
+{
+    const QString imageUrl = m_server.baseUrl() + QStringLiteral("/images/logo.png");
+    m_server.setFault(QStringLiteral("/images/logo.png"), FakeIconServer::TruncatedBody);
+
+    auto cache = createCache();
+    QSignalSpy ready(cache.get(), &FaviconCache::imageReady);
+    QVERIFY(cache->getImageUrl(imageUrl).isEmpty());
+    QTRY_COMPARE_WITH_TIMEOUT(cache->cacheStats().value(QStringLiteral("backedOff")).toInt(), 1, 5000);
+    QCOMPARE(ready.count(), 0);
+    QCOMPARE(cache->cacheStats().value(QStringLiteral("entries")).toInt(), 0);
+}
+
+void FaviconCacheTest::capsConcurrentDownloads()
+{
+    m_server.setResponseDelay(50);
+
+    auto cache = createCache();
+    QSignalSpy ready(cache.get(), &FaviconCache::faviconReady);
+    constexpr int hosts = 16;
+    for (int i = 0; i < hosts; ++i) {
+        cache->getFavicon(serviceUrl(QStringLiteral("host%1.example.org").arg(i)), true);
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(ready.count(), hosts, 10000);
+
+    QCOMPARE(m_server.requests().size(), hosts);
+    QCOMPARE(m_server.maxConcurrentRequests(), 4);
+}
+
+void FaviconCacheTest::timedOutDownloadsFreeTheirSlot()
+{
+    // Every slot stuck on a dead host: the rest only get through once those time out
+    constexpr int stuck = 4;
+    for (int i = 0; i < stuck; ++i) {
+        m_server.setFault(QStringLiteral("/google/stuck%1.test").arg(i), FakeIconServer::Hang);
+    }
+
+    auto cache = createCache();
+    QSignalSpy ready(cache.get(), &FaviconCache::faviconReady);
+    for (int i = 0; i < stuck; ++i) {
+        cache->getFavicon(serviceUrl(QStringLiteral("stuck%1.test").arg(i)), true);
+    }
+    const QString healthy = serviceUrl(QStringLiteral("healthy.test"));
+    cache->getFavicon(healthy, true);
+
+    QVERIFY(ready.wait(5000));
+    QCOMPARE(ready.count(), 1);
+    QCOMPARE(ready.first().at(0).toString(), healthy);
+    QTRY_COMPARE_WITH_TIMEOUT(cache->cacheStats().value(QStringLiteral("backedOff")).toInt(), stuck, 5000);
+}
+
+QTEST_GUILESS_MAIN(FaviconCacheTest)
+#include "faviconcachetest.moc"
@@ -0,0 +1,163 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "utils/faviconimageprovider.h"
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+class FaviconImageStoreTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void decodesOnceAndCountsHits();
+    void scalesToRequestedSize();
+    void invalidateDropsEverySize();
+    void evictsLeastRecentlyUsed();
+    void unknownIdIsNull();
+    void providerIgnoresVersion();
+    void roundsCorners();
+
+private:
+    QString writeIcon(const QString &name, int size, const QColor &color);
+    FaviconImageStore::PathResolver resolver() const;
+
+    QTemporaryDir m_dir;
+};
+
+void FaviconImageStoreTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+QString FaviconImageStoreTest::writeIcon(const QString &name, int size, const QColor &color)
+{
+    QImage image(size, size, QImage::Format_ARGB32);
+    image.fill(color);
+    const QString path = m_dir.filePath(name + QStringLiteral(".png"));
+    image.save(path);
+    return path;
+}
+
+FaviconImageStore::PathResolver FaviconImageStoreTest::resolver() const
+{
+    const QString dir = m_dir.path();
+    return [dir](const QString &id) {
+        const QString path = dir + QLatin1Char('/') + id + QStringLiteral(".png");
+        return QFile::exists(path) ? path : QString();
+    };
+}
+
+void FaviconImageStoreTest::decodesOnceAndCountsHits()
+{
+    writeIcon(QStringLiteral("a"), 64, Qt::red);
+    FaviconImageStore store(resolver(), 1024 * 1024);
+
+    const QImage first = store.image(QStringLiteral("a"), QSize());
+    QCOMPARE(first.size(), QSize(64, 64));
+    QCOMPARE(first.pixelColor(0, 0), QColor(Qt::red));
+
+    // Served from memory even once the file is gone
+    QFile::remove(m_dir.filePath(QStringLiteral("a.png")));
+    QCOMPARE(store.image(QStringLiteral("a"), QSize()).size(), QSize(64, 64));
+
+    const FaviconImageStore::Stats stats = store.stats();
+    QCOMPARE(stats.hits, qint64(1));
+    QCOMPARE(stats.misses, qint64(1));
+    QCOMPARE(stats.entries, 1);
+    QCOMPARE(stats.bytes, qint64(64 * 64 * 4));
+}
+
+void FaviconImageStoreTest::scalesToRequestedSize()
+{
+    writeIcon(QStringLiteral("b"), 128, Qt::blue);
+    FaviconImageStore store(resolver(), 1024 * 1024);
+
+    QCOMPARE(store.image(QStringLiteral("b"), QSize(32, 32)).size(), QSize(32, 32));
+    QCOMPARE(store.image(QStringLiteral("b"), QSize(48, 0)).size(), QSize(48, 48));
+    // Never upscaled
+    QCOMPARE(store.image(QStringLiteral("b"), QSize(256, 256)).size(), QSize(128, 128));
+    QCOMPARE(store.stats().entries, 3);
+}
+
+void FaviconImageStoreTest::invalidateDropsEverySize()
+{
+    writeIcon(QStringLiteral("c"), 64, Qt::red);
+    FaviconImageStore store(resolver(), 1024 * 1024);
+    store.image(QStringLiteral("c"), QSize());
+    store.image(QStringLiteral("c"), QSize(16, 16));
+
+    writeIcon(QStringLiteral("c"), 64, Qt::green);
+    store.invalidate(QStringLiteral("c"));
+    QCOMPARE(store.stats().entries, 0);
+    QCOMPARE(store.image(QStringLiteral("c"), QSize()).pixelColor(0, 0), QColor(Qt::green));
+}
+
+void FaviconImageStoreTest::evictsLeastRecentlyUsed()
+{
+    writeIcon(QStringLiteral("d1"), 64, Qt::red);
+    writeIcon(QStringLiteral("d2"), 64, Qt::red);
+    writeIcon(QStringLiteral("d3"), 64, Qt::red);
+    // Room for two 64x64 ARGB images
+    FaviconImageStore store(resolver(), 2 * 64 * 64 * 4);
+
+    store.image(QStringLiteral("d1"), QSize());
+    store.image(QStringLiteral("d2"), QSize());
+    store.image(QStringLiteral("d1"), QSize());
+    store.image(QStringLiteral("d3"), QSize());
+    QCOMPARE(store.stats().entries, 2);
+    QVERIFY(store.stats().bytes <= 2 * 64 * 64 * 4);
+
+    // d2 was the least recently used, so it is the one decoded again
+    const qint64 misses = store.stats().misses;
+    store.image(QStringLiteral("d1"), QSize());
+    QCOMPARE(store.stats().misses, misses);
+    store.image(QStringLiteral("d2"), QSize());
+    QCOMPARE(store.stats().misses, misses + 1);
+}
+
+void FaviconImageStoreTest::unknownIdIsNull()
+{
+    FaviconImageStore store(resolver(), 1024 * 1024);
+    QVERIFY(store.image(QStringLiteral("missing"), QSize()).isNull());
+    QCOMPARE(store.stats().entries, 0);
+}
+
+void FaviconImageStoreTest::providerIgnoresVersion()
+{
+    writeIcon(QStringLiteral("e"), 64, Qt::red);
+    auto store = std::make_shared<FaviconImageStore>(resolver(), 1024 * 1024);
+    FaviconImageProvider provider(store);
+
+    QSize size;
+    QCOMPARE(provider.requestImage(QStringLiteral("e?v=0123abcd"), &size, QSize(16, 16)).size(), QSize(16, 16));
+    QCOMPARE(size, QSize(16, 16));
+    // Same decoded entry whatever the version
+    provider.requestImage(QStringLiteral("e?v=89abcdef"), &size, QSize(16, 16));
+    QCOMPARE(store->stats().hits, qint64(1));
+    QCOMPARE(store->stats().entries, 1);
+}
+
+void FaviconImageStoreTest::roundsCorners()
+{
+    writeIcon(QStringLiteral("f"), 64, Qt::red);
+    auto store = std::make_shared<FaviconImageStore>(resolver(), 1024 * 1024);
+    FaviconImageProvider provider(store);
+
+    QSize size;
+    const QImage rounded = provider.requestImage(QStringLiteral("f?v=0123abcd&r=8"), &size, QSize(32, 32));
+    QCOMPARE(size, QSize(32, 32));
+    QCOMPARE(rounded.pixelColor(0, 0).alpha(), 0);
+    QCOMPARE(rounded.pixelColor(16, 16), QColor(Qt::red));
+
+    // Square and rounded variants are cached side by side, and dropped together
+    QCOMPARE(store->image(QStringLiteral("f"), QSize(32, 32)).pixelColor(0, 0), QColor(Qt::red));
+    QCOMPARE(store->stats().entries, 2);
+    store->invalidate(QStringLiteral("f"));
+    QCOMPARE(store->stats().entries, 0);
+}
+
+QTEST_MAIN(FaviconImageStoreTest)
+#include "faviconimagestoretest.moc"
@@ -0,0 +1,157 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "core/notificationcoalescer.h"
+
+#include <QtTest>
+
+class NotificationCoalescerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void mergesWithinBurstWindow();
+    void windowSlidesWithEachMessage();
+    void showsAfterWindow();
+    void showsWhenPreviousClosed();
+    void capsRatePerMinute();
+    void mergesDoNotCountAgainstCap();
+    void flushesDelayedMessages();
+    void keysAreIndependent();
+    void disabledPassesEverything();
+};
+
+void NotificationCoalescerTest::mergesWithinBurstWindow()
+{
+    NotificationCoalescer coalescer;
+    coalescer.setBurstWindow(10000);
+
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 0, false), NotificationCoalescer::Show);
+    QCOMPARE(coalescer.count(QStringLiteral("chat")), 1);
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 1000, true), NotificationCoalescer::Merge);
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 5000, true), NotificationCoalescer::Merge);
+    QCOMPARE(coalescer.count(QStringLiteral("chat")), 3);
+
+    const NotificationCoalescer::Stats stats = coalescer.stats();
+    QCOMPARE(stats.shown, qint64(1));
+    QCOMPARE(stats.merged, qint64(2));
+    QCOMPARE(stats.suppressed, qint64(0));
+}
+
+void NotificationCoalescerTest::windowSlidesWithEachMessage()
+{
+    NotificationCoalescer coalescer;
+    coalescer.setBurstWindow(10000);
+
+    coalescer.add(QStringLiteral("chat"), 0, false);
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 9000, true), NotificationCoalescer::Merge);
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 18000, true), NotificationCoalescer::Merge);
+    QCOMPARE(coalescer.count(QStringLiteral("chat")), 3);
+}
+
+void NotificationCoalescerTest::showsAfterWindow()
+{
+    NotificationCoalescer coalescer;
+    coalescer.setBurstWindow(10000);
+
+    coalescer.add(QStringLiteral("chat"), 0, false);
+    coalescer.add(QStringLiteral("chat"), 1000, true);
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 11000, true), NotificationCoalescer::Show);
+    QCOMPARE(coalescer.count(QStringLiteral("chat")), 1);
+}
+
+void NotificationCoalescerTest::showsWhenPreviousClosed()
+{
+    NotificationCoalescer coalescer;
+    coalescer.setBurstWindow(10000);
+
+    coalescer.add(QStringLiteral("chat"), 0, false);
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 1000, false), NotificationCoalescer::Show);
+    QCOMPARE(coalescer.count(QStringLiteral("chat")), 1);
+}
+
+void NotificationCoalescerTest::capsRatePerMinute()
+{
+    NotificationCoalescer coalescer;
+    coalescer.setRateLimit(3);
+
+    for (qint64 now = 0; now < 3; ++now) {
+        QCOMPARE(coalescer.add(QStringLiteral("chat"), now, false), NotificationCoalescer::Show);
+    }
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 3, false), NotificationCoalescer::Suppress);
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 59999, false), NotificationCoalescer::Suppress);
+
+    // The first slot frees up a minute later; the next one shown stands for the delayed ones too
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 60000, false), NotificationCoalescer::Show);
+    QCOMPARE(coalescer.count(QStringLiteral("chat")), 3);
+
+    const NotificationCoalescer::Stats stats = coalescer.stats();
+    QCOMPARE(stats.shown, qint64(4));
+    QCOMPARE(stats.suppressed, qint64(2));
+}
+
+void NotificationCoalescerTest::mergesDoNotCountAgainstCap()
+{
+    NotificationCoalescer coalescer;
+    coalescer.setBurstWindow(10000);
+    coalescer.setRateLimit(1);
+
+    // A message every 5 s keeps updating the one notification all minute
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 0, false), NotificationCoalescer::Show);
+    for (qint64 now = 5000; now < 60000; now += 5000) {
+        QCOMPARE(coalescer.add(QStringLiteral("chat"), now, true), NotificationCoalescer::Merge);
+    }
+    QCOMPARE(coalescer.count(QStringLiteral("chat")), 12);
+    QCOMPARE(coalescer.stats().suppressed, qint64(0));
+    QCOMPARE(coalescer.flushAt(QStringLiteral("chat")), qint64(-1));
+}
+
+void NotificationCoalescerTest::flushesDelayedMessages()
+{
+    NotificationCoalescer coalescer;
+    coalescer.setBurstWindow(10000);
+    coalescer.setRateLimit(1);
+
+    coalescer.add(QStringLiteral("chat"), 0, false);
+    QCOMPARE(coalescer.flush(QStringLiteral("chat"), 1, true), NotificationCoalescer::Suppress);
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 20000, false), NotificationCoalescer::Suppress);
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 30000, false), NotificationCoalescer::Suppress);
+    QCOMPARE(coalescer.flushAt(QStringLiteral("chat")), qint64(60000));
+
+    QCOMPARE(coalescer.flush(QStringLiteral("chat"), 59999, false), NotificationCoalescer::Suppress);
+    QCOMPARE(coalescer.flush(QStringLiteral("chat"), 60000, false), NotificationCoalescer::Show);
+    QCOMPARE(coalescer.count(QStringLiteral("chat")), 2);
+    QCOMPARE(coalescer.flushAt(QStringLiteral("chat")), qint64(-1));
+    QCOMPARE(coalescer.flush(QStringLiteral("chat"), 60001, false), NotificationCoalescer::Suppress);
+
+    const NotificationCoalescer::Stats stats = coalescer.stats();
+    QCOMPARE(stats.shown, qint64(2));
+    QCOMPARE(stats.suppressed, qint64(2));
+}
+
+void NotificationCoalescerTest::keysAreIndependent()
+{
+    NotificationCoalescer coalescer;
+    coalescer.setBurstWindow(10000);
+    coalescer.setRateLimit(1);
+
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 0, false), NotificationCoalescer::Show);
+    QCOMPARE(coalescer.add(QStringLiteral("mail"), 1, true), NotificationCoalescer::Show);
+    QCOMPARE(coalescer.add(QStringLiteral("chat"), 2, false), NotificationCoalescer::Suppress);
+    QCOMPARE(coalescer.count(QStringLiteral("mail")), 1);
+    QCOMPARE(coalescer.flushAt(QStringLiteral("mail")), qint64(-1));
+    QCOMPARE(coalescer.count(QStringLiteral("unknown")), 0);
+}
+
+void NotificationCoalescerTest::disabledPassesEverything()
+{
+    NotificationCoalescer coalescer;
+
+    for (int i = 0; i < 100; ++i) {
+        QCOMPARE(coalescer.add(QStringLiteral("chat"), 0, true), NotificationCoalescer::Show);
+    }
+    QCOMPARE(coalescer.stats().shown, qint64(100));
+}
+
+QTEST_MAIN(NotificationCoalescerTest)
+#include "notificationcoalescertest.moc"
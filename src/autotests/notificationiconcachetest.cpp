@@ -0,0 +1,101 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "core/notificationiconcache.h"
+
+#include <QtTest>
+
+class NotificationIconCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void downscalesLargeIcons();
+    void keepsSmallIcons();
+    void reusesSameContent();
+    void distinguishesContent();
+    void evictsOverBudget();
+    void nullIcon();
+
+private:
+    static QImage avatar(int width, int height, QRgb color);
+};
+
+QImage NotificationIconCacheTest::avatar(int width, int height, QRgb color)
+{
+    QImage image(width, height, QImage::Format_ARGB32);
+    image.fill(color);
+    return image;
+}
+
+void NotificationIconCacheTest::downscalesLargeIcons()
+{
+    NotificationIconCache cache(64);
+
+    const QPixmap pixmap = cache.pixmap(avatar(512, 256, qRgb(200, 30, 30)));
+    QCOMPARE(pixmap.size(), QSize(64, 32));
+}
+
+void NotificationIconCacheTest::keepsSmallIcons()
+{
+    NotificationIconCache cache(64);
+
+    const QPixmap pixmap = cache.pixmap(avatar(48, 48, qRgb(30, 200, 30)));
+    QCOMPARE(pixmap.size(), QSize(48, 48));
+}
+
+void NotificationIconCacheTest::reusesSameContent()
+{
+    NotificationIconCache cache(64);
+
+    // Separate QImages, as each web notification brings its own
+    const QPixmap first = cache.pixmap(avatar(256, 256, qRgb(30, 30, 200)));
+    const QPixmap second = cache.pixmap(avatar(256, 256, qRgb(30, 30, 200)));
+    QCOMPARE(second.cacheKey(), first.cacheKey());
+    QCOMPARE(cache.stats().hits, qint64(1));
+    QCOMPARE(cache.stats().misses, qint64(1));
+}
+
+void NotificationIconCacheTest::distinguishesContent()
+{
+    NotificationIconCache cache(64);
+
+    QImage changed = avatar(256, 256, qRgb(30, 30, 200));
+    const size_t key = NotificationIconCache::contentKey(changed);
+    changed.setPixel(255, 255, qRgb(31, 30, 200));
+    QVERIFY(NotificationIconCache::contentKey(changed) != key);
+    QVERIFY(NotificationIconCache::contentKey(avatar(128, 512, qRgb(0, 0, 0))) != NotificationIconCache::contentKey(avatar(512, 128, qRgb(0, 0, 0))));
+
+    cache.pixmap(avatar(256, 256, qRgb(30, 30, 200)));
+    cache.pixmap(changed);
+    QCOMPARE(cache.stats().misses, qint64(2));
+}
+
+void NotificationIconCacheTest::evictsOverBudget()
+{
+    // Room for two 64x64 pixmaps
+    NotificationIconCache cache(64, 2 * 64 * 64 * 4);
+
+    cache.pixmap(avatar(128, 128, qRgb(1, 0, 0)));
+    cache.pixmap(avatar(128, 128, qRgb(2, 0, 0)));
+    cache.pixmap(avatar(128, 128, qRgb(1, 0, 0)));
+    cache.pixmap(avatar(128, 128, qRgb(3, 0, 0)));
+    QCOMPARE(cache.stats().hits, qint64(1));
+
+    // The least recently used one went, the one just used stayed
+    cache.pixmap(avatar(128, 128, qRgb(1, 0, 0)));
+    QCOMPARE(cache.stats().hits, qint64(2));
+    cache.pixmap(avatar(128, 128, qRgb(2, 0, 0)));
+    QCOMPARE(cache.stats().misses, qint64(4));
+}
+
+void NotificationIconCacheTest::nullIcon()
+{
+    NotificationIconCache cache(64);
+
+    QVERIFY(cache.pixmap(QImage()).isNull());
+    QCOMPARE(cache.stats().misses, qint64(0));
+}
+
+QTEST_MAIN(NotificationIconCacheTest)
+#include "notificationiconcachetest.moc"
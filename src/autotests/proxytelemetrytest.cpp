@@ -0,0 +1,139 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "core/proxytelemetry.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSignalSpy>
+#include <QtTest>
+
+class ProxyTelemetryTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void histogramPercentiles();
+    void histogramClampsOutliers();
+    void recordsPerHost();
+    void statsJsonAndReset();
+};
+
+void ProxyTelemetryTest::histogramPercentiles()
+{
+    LatencyHistogram histogram;
+    QCOMPARE(histogram.percentile(0.5), qint64(0));
+
+    for (qint64 micros = 1; micros <= 10000; ++micros) {
+        histogram.record(micros);
+    }
+    QCOMPARE(histogram.count(), qint64(10000));
+    QCOMPARE(histogram.max(), qint64(10000));
+
+    // Bucket upper bounds: never below the exact value, at most 1/16 above it
+    const QList<QPair<double, qint64>> expected{{0.50, 5000}, {0.95, 9500}, {0.99, 9900}, {1.0, 10000}};
+    for (const auto &[fraction, exact] : expected) {
+        const qint64 value = histogram.percentile(fraction);
+        QVERIFY2(value >= exact && value <= exact + exact / 16, qPrintable(QStringLiteral("p%1 = %2").arg(fraction).arg(value)));
+    }
+
+    // Small values are exact
+    LatencyHistogram small;
+    small.record(3);
+    small.record(7);
+    QCOMPARE(small.percentile(0.5), qint64(3));
+    QCOMPARE(small.percentile(1.0), qint64(7));
+
+    histogram.reset();
+    QCOMPARE(histogram.count(), qint64(0));
+    QCOMPARE(histogram.max(), qint64(0));
+}
+
+void ProxyTelemetryTest::histogramClampsOutliers()
+{
+    LatencyHistogram histogram;
+    histogram.record(-5);
+    histogram.record(std::numeric_limits<qint64>::max());
+    QCOMPARE(histogram.count(), qint64(2));
+    QCOMPARE(histogram.percentile(0.5), qint64(0));
+    QVERIFY(histogram.percentile(1.0) > 0);
+}
+
+void ProxyTelemetryTest::recordsPerHost()
+{
+    ProxyTelemetry telemetry;
+    QSignalSpy inserted(&telemetry, &QAbstractItemModel::rowsInserted);
+    QSignalSpy changed(&telemetry, &QAbstractItemModel::dataChanged);
+
+    ProxyTelemetry::Sample ok;
+    ok.host = QStringLiteral("api.example.com");
+    ok.status = 200;
+    ok.queueMicros = 100;
+    ok.sidecarMicros = 400;
+    ok.upstreamMicros = 20000;
+    ok.totalMicros = 21000;
+    ok.bytesOut = 10;
+    ok.bytesIn = 1000;
+    telemetry.record(ok);
+
+    ProxyTelemetry::Sample notFound = ok;
+    notFound.status = 404;
+    telemetry.record(notFound);
+
+    ProxyTelemetry::Sample failed;
+    failed.host = QStringLiteral("other.example.com");
+    failed.totalMicros = 45000000;
+    telemetry.record(failed);
+
+    QCOMPARE(telemetry.rowCount(), 2);
+    QCOMPARE(inserted.count(), 2);
+    QCOMPARE(changed.count(), 3);
+    QCOMPARE(telemetry.hosts(), QStringList({QStringLiteral("api.example.com"), QStringLiteral("other.example.com")}));
+
+    const QModelIndex first = telemetry.index(0);
+    QCOMPARE(first.data(ProxyTelemetry::HostRole).toString(), QStringLiteral("api.example.com"));
+    QCOMPARE(first.data(ProxyTelemetry::RequestsRole).toLongLong(), qint64(2));
+    QCOMPARE(first.data(ProxyTelemetry::FailuresRole).toLongLong(), qint64(0));
+    QCOMPARE(first.data(ProxyTelemetry::Status2xxRole).toLongLong(), qint64(1));
+    QCOMPARE(first.data(ProxyTelemetry::Status4xxRole).toLongLong(), qint64(1));
+    QCOMPARE(first.data(ProxyTelemetry::Status5xxRole).toLongLong(), qint64(0));
+    QCOMPARE(first.data(ProxyTelemetry::BytesInRole).toLongLong(), qint64(2000));
+    QCOMPARE(first.data(ProxyTelemetry::BytesOutRole).toLongLong(), qint64(20));
+    QCOMPARE(first.data(ProxyTelemetry::QueueP50Role).toDouble(), 0.1);
+    const double upstream = first.data(ProxyTelemetry::UpstreamP50Role).toDouble();
+    QVERIFY(upstream >= 20.0 && upstream <= 21.25);
+
+    const QModelIndex second = telemetry.index(1);
+    QCOMPARE(second.data(ProxyTelemetry::FailuresRole).toLongLong(), qint64(1));
+    // Unknown phases are left out rather than recorded as zero
+    QCOMPARE(second.data(ProxyTelemetry::QueueP50Role).toDouble(), 0.0);
+    QVERIFY(second.data(ProxyTelemetry::TotalP99Role).toDouble() >= 45000.0);
+}
+
+void ProxyTelemetryTest::statsJsonAndReset()
+{
+    ProxyTelemetry telemetry;
+    ProxyTelemetry::Sample sample;
+    sample.host = QStringLiteral("api.example.com");
+    sample.status = 503;
+    sample.upstreamMicros = 1500;
+    sample.totalMicros = 2000;
+    telemetry.record(sample);
+
+    const QJsonObject stats = QJsonDocument::fromJson(telemetry.statsJson().toUtf8()).object();
+    const QJsonObject host = stats.value(QStringLiteral("api.example.com")).toObject();
+    QCOMPARE(host.value(QStringLiteral("requests")).toInt(), 1);
+    QCOMPARE(host.value(QStringLiteral("status")).toObject().value(QStringLiteral("5xx")).toInt(), 1);
+    QCOMPARE(host.value(QStringLiteral("upstream")).toObject().value(QStringLiteral("count")).toInt(), 1);
+    QCOMPARE(host.value(QStringLiteral("queue")).toObject().value(QStringLiteral("count")).toInt(), 0);
+    QCOMPARE(host.value(QStringLiteral("total")).toObject().value(QStringLiteral("max")).toDouble(), 2.0);
+
+    QSignalSpy reset(&telemetry, &QAbstractItemModel::modelReset);
+    telemetry.reset();
+    QCOMPARE(reset.count(), 1);
+    QCOMPARE(telemetry.rowCount(), 0);
+    QCOMPARE(telemetry.statsJson(), QStringLiteral("{}"));
+}
+
+QTEST_MAIN(ProxyTelemetryTest)
+#include "proxytelemetrytest.moc"
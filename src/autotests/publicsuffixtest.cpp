@@ -0,0 +1,198 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "utils/publicsuffix.h"
+
+#include <QtTest>
+
+class PublicSuffixTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void registrableDomain_data();
+    void registrableDomain();
+    void publicSuffix_data();
+    void publicSuffix();
+    void rejectsAddressesAndMalformedHosts();
+    void sameSite();
+    void benchmarkRegistrableDomain_data();
+    void benchmarkRegistrableDomain();
+};
+
+void PublicSuffixTest::registrableDomain_data()
+{
+    QTest::addColumn<QString>("host");
+    QTest::addColumn<QString>("expected");
+
+    // checkPublicSuffix() vectors from the publicsuffix.org test suite
+    // (tests/test_psl.txt); null results are empty strings here
+    const QList<QPair<QString, QString>> vectors{
+        // null input
+        {QString(), QString()},
+        // Mixed case
+        {QStringLiteral("COM"), QString()},
+        {QStringLiteral("example.COM"), QStringLiteral("example.com")},
+        {QStringLiteral("WwW.example.COM"), QStringLiteral("example.com")},
+        // Leading dot
+        {QStringLiteral(".com"), QString()},
+        {QStringLiteral(".example"), QString()},
+        {QStringLiteral(".example.com"), QString()},
+        {QStringLiteral(".example.example"), QString()},
+        // Unlisted TLD
+        {QStringLiteral("example"), QString()},
+        {QStringLiteral("example.example"), QStringLiteral("example.example")},
+        {QStringLiteral("b.example.example"), QStringLiteral("example.example")},
+        {QStringLiteral("a.b.example.example"), QStringLiteral("example.example")},
+        // TLD with only 1 rule
+        {QStringLiteral("biz"), QString()},
+        {QStringLiteral("domain.biz"), QStringLiteral("domain.biz")},
+        {QStringLiteral("b.domain.biz"), QStringLiteral("domain.biz")},
+        {QStringLiteral("a.b.domain.biz"), QStringLiteral("domain.biz")},
+        // TLD with some 2-level rules
+        {QStringLiteral("com"), QString()},
+        {QStringLiteral("example.com"), QStringLiteral("example.com")},
+        {QStringLiteral("b.example.com"), QStringLiteral("example.com")},
+        {QStringLiteral("a.b.example.com"), QStringLiteral("example.com")},
+        {QStringLiteral("uk.com"), QString()},
+        {QStringLiteral("example.uk.com"), QStringLiteral("example.uk.com")},
+        {QStringLiteral("b.example.uk.com"), QStringLiteral("example.uk.com")},
+        {QStringLiteral("a.b.example.uk.com"), QStringLiteral("example.uk.com")},
+        {QStringLiteral("test.ac"), QStringLiteral("test.ac")},
+        // TLD with only 1 (wildcard) rule
+        {QStringLiteral("mm"), QString()},
+        {QStringLiteral("c.mm"), QString()},
+        {QStringLiteral("b.c.mm"), QStringLiteral("b.c.mm")},
+        {QStringLiteral("a.b.c.mm"), QStringLiteral("b.c.mm")},
+        // More complex TLD
+        {QStringLiteral("jp"), QString()},
+        {QStringLiteral("test.jp"), QStringLiteral("test.jp")},
+        {QStringLiteral("www.test.jp"), QStringLiteral("test.jp")},
+        {QStringLiteral("ac.jp"), QString()},
+        {QStringLiteral("test.ac.jp"), QStringLiteral("test.ac.jp")},
+        {QStringLiteral("www.test.ac.jp"), QStringLiteral("test.ac.jp")},
+        {QStringLiteral("kyoto.jp"), QString()},
+        {QStringLiteral("test.kyoto.jp"), QStringLiteral("test.kyoto.jp")},
+        {QStringLiteral("ide.kyoto.jp"), QString()},
+        {QStringLiteral("b.ide.kyoto.jp"), QStringLiteral("b.ide.kyoto.jp")},
+        {QStringLiteral("a.b.ide.kyoto.jp"), QStringLiteral("b.ide.kyoto.jp")},
+        {QStringLiteral("c.kobe.jp"), QString()},
+        {QStringLiteral("b.c.kobe.jp"), QStringLiteral("b.c.kobe.jp")},
+        {QStringLiteral("a.b.c.kobe.jp"), QStringLiteral("b.c.kobe.jp")},
+        {QStringLiteral("city.kobe.jp"), QStringLiteral("city.kobe.jp")},
+        {QStringLiteral("www.city.kobe.jp"), QStringLiteral("city.kobe.jp")},
+        // TLD with a wildcard rule and exceptions
+        {QStringLiteral("ck"), QString()},
+        {QStringLiteral("test.ck"), QString()},
+        {QStringLiteral("b.test.ck"), QStringLiteral("b.test.ck")},
+        {QStringLiteral("a.b.test.ck"), QStringLiteral("b.test.ck")},
+        {QStringLiteral("www.ck"), QStringLiteral("www.ck")},
+        {QStringLiteral("www.www.ck"), QStringLiteral("www.ck")},
+        // US K12
+        {QStringLiteral("us"), QString()},
+        {QStringLiteral("test.us"), QStringLiteral("test.us")},
+        {QStringLiteral("www.test.us"), QStringLiteral("test.us")},
+        {QStringLiteral("ak.us"), QString()},
+        {QStringLiteral("test.ak.us"), QStringLiteral("test.ak.us")},
+        {QStringLiteral("www.test.ak.us"), QStringLiteral("test.ak.us")},
+        {QStringLiteral("k12.ak.us"), QString()},
+        {QStringLiteral("test.k12.ak.us"), QStringLiteral("test.k12.ak.us")},
+        {QStringLiteral("www.test.k12.ak.us"), QStringLiteral("test.k12.ak.us")},
+        // IDN labels
+        {QStringLiteral("食狮.com.cn"), QStringLiteral("食狮.com.cn")},
+        {QStringLiteral("食狮.公司.cn"), QStringLiteral("食狮.公司.cn")},
+        {QStringLiteral("www.食狮.公司.cn"), QStringLiteral("食狮.公司.cn")},
+        {QStringLiteral("shishi.公司.cn"), QStringLiteral("shishi.公司.cn")},
+        {QStringLiteral("公司.cn"), QString()},
+        {QStringLiteral("食狮.中国"), QStringLiteral("食狮.中国")},
+        {QStringLiteral("www.食狮.中国"), QStringLiteral("食狮.中国")},
+        {QStringLiteral("shishi.中国"), QStringLiteral("shishi.中国")},
+        {QStringLiteral("中国"), QString()},
+        // Same as above, but punycoded
+        {QStringLiteral("xn--85x722f.com.cn"), QStringLiteral("xn--85x722f.com.cn")},
+        {QStringLiteral("xn--85x722f.xn--55qx5d.cn"), QStringLiteral("xn--85x722f.xn--55qx5d.cn")},
+        {QStringLiteral("www.xn--85x722f.xn--55qx5d.cn"), QStringLiteral("xn--85x722f.xn--55qx5d.cn")},
+        {QStringLiteral("shishi.xn--55qx5d.cn"), QStringLiteral("shishi.xn--55qx5d.cn")},
+        {QStringLiteral("xn--55qx5d.cn"), QString()},
+        {QStringLiteral("xn--85x722f.xn--fiqs8s"), QStringLiteral("xn--85x722f.xn--fiqs8s")},
+        {QStringLiteral("www.xn--85x722f.xn--fiqs8s"), QStringLiteral("xn--85x722f.xn--fiqs8s")},
+        {QStringLiteral("shishi.xn--fiqs8s"), QStringLiteral("shishi.xn--fiqs8s")},
+        {QStringLiteral("xn--fiqs8s"), QString()},
+    };
+    for (const auto &[host, expected] : vectors) {
+        QTest::newRow(host.isNull() ? "null" : qPrintable(host)) << host << expected;
+    }
+}
+
+void PublicSuffixTest::registrableDomain()
+{
+    QFETCH(QString, host);
+    QFETCH(QString, expected);
+    QCOMPARE(PublicSuffix::registrableDomain(host), expected);
+}
+
+void PublicSuffixTest::publicSuffix_data()
+{
+    QTest::addColumn<QString>("host");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("single label rule") << QStringLiteral("web.whatsapp.com") << QStringLiteral("com");
+    QTest::newRow("two label rule") << QStringLiteral("mail.example.co.uk") << QStringLiteral("co.uk");
+    QTest::newRow("com.br") << QStringLiteral("www.example.com.br") << QStringLiteral("com.br");
+    QTest::newRow("private section") << QStringLiteral("alice.github.io") << QStringLiteral("github.io");
+    QTest::newRow("wildcard") << QStringLiteral("a.b.c.mm") << QStringLiteral("c.mm");
+    QTest::newRow("exception") << QStringLiteral("www.ck") << QStringLiteral("ck");
+    QTest::newRow("unlisted tld") << QStringLiteral("intranet.corp") << QStringLiteral("corp");
+    QTest::newRow("trailing dot") << QStringLiteral("example.co.uk.") << QStringLiteral("co.uk");
+}
+
+void PublicSuffixTest::publicSuffix()
+{
+    QFETCH(QString, host);
+    QFETCH(QString, expected);
+    QCOMPARE(PublicSuffix::publicSuffix(host), expected);
+}
+
+void PublicSuffixTest::rejectsAddressesAndMalformedHosts()
+{
+    QVERIFY(PublicSuffix::registrableDomain(QStringLiteral("192.168.1.10")).isEmpty());
+    QVERIFY(PublicSuffix::registrableDomain(QStringLiteral("::1")).isEmpty());
+    QVERIFY(PublicSuffix::registrableDomain(QStringLiteral("[2001:db8::1]")).isEmpty());
+    QVERIFY(PublicSuffix::registrableDomain(QStringLiteral("a..example.com")).isEmpty());
+    QVERIFY(PublicSuffix::publicSuffix(QStringLiteral("127.0.0.1")).isEmpty());
+    QVERIFY(PublicSuffix::publicSuffix(QString()).isEmpty());
+}
+
+void PublicSuffixTest::sameSite()
+{
+    QVERIFY(PublicSuffix::isSameSite(QStringLiteral("mail.google.com"), QStringLiteral("calendar.google.com")));
+    QVERIFY(PublicSuffix::isSameSite(QStringLiteral("web.whatsapp.com"), QStringLiteral("WhatsApp.com")));
+    QVERIFY(PublicSuffix::isSameSite(QStringLiteral("www.bbc.co.uk"), QStringLiteral("news.bbc.co.uk")));
+    QVERIFY(!PublicSuffix::isSameSite(QStringLiteral("bbc.co.uk"), QStringLiteral("itv.co.uk")));
+    QVERIFY(!PublicSuffix::isSameSite(QStringLiteral("alice.github.io"), QStringLiteral("bob.github.io")));
+    // Public suffixes aren't a site, not even the same one
+    QVERIFY(!PublicSuffix::isSameSite(QStringLiteral("co.uk"), QStringLiteral("co.uk")));
+}
+
+void PublicSuffixTest::benchmarkRegistrableDomain_data()
+{
+    QTest::addColumn<QString>("host");
+
+    QTest::newRow("short") << QStringLiteral("web.whatsapp.com");
+    QTest::newRow("deep") << QStringLiteral("a.b.c.d.mail.example.co.uk");
+    QTest::newRow("wildcard") << QStringLiteral("www.city.kobe.jp");
+    QTest::newRow("idn") << QStringLiteral("www.食狮.公司.cn");
+}
+
+void PublicSuffixTest::benchmarkRegistrableDomain()
+{
+    QFETCH(QString, host);
+    QString result;
+    QBENCHMARK {
+        result = PublicSuffix::registrableDomain(host);
+    }
+    QVERIFY(!result.isEmpty());
+}
+
+QTEST_MAIN(PublicSuffixTest)
+#include "publicsuffixtest.moc"
@@ -0,0 +1,247 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Load test for TlsProxyBridge. Fires thousands of fetchViaProxy calls at once
+// against an in-process fake sidecar (own thread, HTTP/1.1 keep-alive) whose
+// fake upstream answers https://bench.invalid/bytes/<n> with n bytes, then
+// reports throughput, latency percentiles, peak RSS and the bytes the
+// page <-> bridge <-> sidecar transport moves. No network access needed.
+//
+//   tlsproxybridgebench --requests 5000 --response-sizes 1024,65536,1048576
+
+#include "core/tlsproxybridge.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QSemaphore>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+QByteArray upstreamBody(const QByteArray &targetUrl)
+{
+    const qsizetype marker = targetUrl.lastIndexOf("/bytes/");
+    const int size = marker >= 0 ? targetUrl.mid(marker + 7).toInt() : 0;
+    return QByteArray(size, 'x');
+}
+
+class FakeSidecar : public QThread
+{
+public:
+    quint16 waitForPort()
+    {
+        m_started.acquire();
+        return m_port;
+    }
+
+protected:
+    void run() override
+    {
+        QTcpServer server;
+        if (!server.listen(QHostAddress::LocalHost)) {
+            m_started.release();
+            return;
+        }
+        m_port = server.serverPort();
+        QObject::connect(&server, &QTcpServer::newConnection, &server, [&server]() {
+            while (QTcpSocket *socket = server.nextPendingConnection()) {
+                serve(socket);
+            }
+        });
+        m_started.release();
+        exec();
+    }
+
+private:
+    static void serve(QTcpSocket *socket)
+    {
+        auto buffer = std::make_shared<QByteArray>();
+        QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        QObject::connect(socket, &QTcpSocket::readyRead, socket, [socket, buffer]() {
+            buffer->append(socket->readAll());
+            for (;;) {
+                const qsizetype headerEnd = buffer->indexOf("\r\n\r\n");
+                if (headerEnd < 0) {
+                    return;
+                }
+                qsizetype contentLength = 0;
+                QByteArray targetUrl;
+                const QList<QByteArray> lines = buffer->left(headerEnd).split('\n');
+                for (const QByteArray &line : lines) {
+                    const qsizetype colon = line.indexOf(':');
+                    if (colon < 0) {
+                        continue;
+                    }
+                    const QByteArray name = line.left(colon).trimmed().toLower();
+                    if (name == "content-length") {
+                        contentLength = line.mid(colon + 1).trimmed().toLongLong();
+                    } else if (name == "x-unify-target-url") {
+                        targetUrl = line.mid(colon + 1).trimmed();
+                    }
+                }
+                if (buffer->size() < headerEnd + 4 + contentLength) {
+                    return;
+                }
+                buffer->remove(0, headerEnd + 4 + contentLength);
+
+                const QByteArray body = upstreamBody(targetUrl);
+                socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: " + QByteArray::number(body.size())
+                              + "\r\n\r\n");
+                socket->write(body);
+            }
+        });
+    }
+
+    QSemaphore m_started;
+    quint16 m_port = 0;
+};
+
+QList<qint64> parseSizes(const QString &value)
+{
+    QList<qint64> sizes;
+    const QStringList parts = value.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        sizes.append(part.trimmed().toLongLong());
+    }
+    if (sizes.isEmpty()) {
+        sizes.append(0);
+    }
+    return sizes;
+}
+
+double percentile(const QList<double> &sorted, double fraction)
+{
+    if (sorted.isEmpty()) {
+        return 0.0;
+    }
+    const qsizetype index = std::min<qsizetype>(sorted.size() - 1, qRound64(fraction * (sorted.size() - 1)));
+    return sorted.at(index);
+}
+
+long peakRssKiB()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    // Never spawn the real cf-proxy.py
+    qputenv("UNIFY_PROXY_SCRIPT", "/nonexistent/cf-proxy.py");
+
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("TlsProxyBridge load test against a local fake sidecar"));
+    parser.addHelpOption();
+    const QCommandLineOption requestsOption(QStringLiteral("requests"), QStringLiteral("Number of fetchViaProxy calls."), QStringLiteral("n"), QStringLiteral("2000"));
+    const QCommandLineOption responseSizesOption(QStringLiteral("response-sizes"),
+                                                 QStringLiteral("Comma-separated response body sizes, cycled."),
+                                                 QStringLiteral("bytes"),
+                                                 QStringLiteral("1024,16384,262144"));
+    const QCommandLineOption requestSizesOption(QStringLiteral("request-sizes"),
+                                                QStringLiteral("Comma-separated request body sizes, cycled; 0 sends a GET."),
+                                                QStringLiteral("bytes"),
+                                                QStringLiteral("0,0,4096"));
+    parser.addOption(requestsOption);
+    parser.addOption(responseSizesOption);
+    parser.addOption(requestSizesOption);
+    parser.process(app);
+
+    const int requestCount = std::max(1, parser.value(requestsOption).toInt());
+    const QList<qint64> responseSizes = parseSizes(parser.value(responseSizesOption));
+    const QList<qint64> requestSizes = parseSizes(parser.value(requestSizesOption));
+
+    FakeSidecar sidecar;
+    sidecar.start();
+    const quint16 port = sidecar.waitForPort();
+    if (port == 0) {
+        std::fprintf(stderr, "failed to start the fake sidecar\n");
+        return 1;
+    }
+
+    TlsProxyBridge bridge;
+    bridge.setProxyBaseUrlForTesting(QUrl(QStringLiteral("http://127.0.0.1:%1/").arg(port)));
+
+    // Encoded once per size: producing the base64 is page-side work, not bridge work
+    QHash<qint64, QString> encodedBodies;
+    for (const qint64 size : requestSizes) {
+        encodedBodies.insert(size, QString::fromLatin1(QByteArray(size, 'u').toBase64()));
+    }
+
+    QElapsedTimer clock;
+    QHash<QString, qint64> startedAt;
+    QHash<QString, qint64> expectedSizes;
+    QList<double> latenciesMs;
+    latenciesMs.reserve(requestCount);
+    qint64 bytesCopied = 0;
+    int failures = 0;
+
+    QObject::connect(&bridge, &TlsProxyBridge::fetchResponse, &app, [&](const QString &requestId, const QJsonObject &response) {
+        latenciesMs.append((clock.nsecsElapsed() - startedAt.take(requestId)) / 1e6);
+        const QString bodyBase64 = response.value(QStringLiteral("bodyBase64")).toString();
+        const qint64 bodySize = QByteArray::fromBase64(bodyBase64.toLatin1()).size();
+        if (response.value(QStringLiteral("status")).toInt() != 200 || bodySize != expectedSizes.take(requestId)) {
+            ++failures;
+        }
+        // Sidecar -> bridge raw body, then bridge -> page base64 (the JSON message)
+        bytesCopied += bodySize + bodyBase64.size();
+        if (latenciesMs.size() == requestCount) {
+            app.quit();
+        }
+    });
+
+    QTimer::singleShot(std::chrono::minutes(5), &app, [&app]() {
+        std::fprintf(stderr, "timed out\n");
+        app.exit(1);
+    });
+
+    clock.start();
+    for (int i = 0; i < requestCount; ++i) {
+        const QString requestId = QStringLiteral("bench-%1").arg(i);
+        const qint64 responseSize = responseSizes.at(i % responseSizes.size());
+        const qint64 requestSize = requestSizes.at(i % requestSizes.size());
+        QJsonObject request{{QStringLiteral("url"), QStringLiteral("https://bench.invalid/bytes/%1").arg(responseSize)},
+                            {QStringLiteral("method"), requestSize > 0 ? QStringLiteral("POST") : QStringLiteral("GET")}};
+        if (requestSize > 0) {
+            request.insert(QStringLiteral("bodyBase64"), encodedBodies.value(requestSize));
+            // Page -> bridge base64, then bridge -> sidecar raw body
+            bytesCopied += encodedBodies.value(requestSize).size() + requestSize;
+        }
+        expectedSizes.insert(requestId, responseSize);
+        startedAt.insert(requestId, clock.nsecsElapsed());
+        bridge.fetchViaProxy(requestId, request);
+    }
+
+    const int exitCode = app.exec();
+    const double elapsedSeconds = clock.nsecsElapsed() / 1e9;
+
+    sidecar.quit();
+    sidecar.wait();
+
+    std::sort(latenciesMs.begin(), latenciesMs.end());
+    std::printf("requests      %lld (%d failed)\n", static_cast<long long>(latenciesMs.size()), failures);
+    std::printf("wall time     %.2f s\n", elapsedSeconds);
+    std::printf("throughput    %.1f req/s\n", latenciesMs.size() / elapsedSeconds);
+    std::printf("p50           %.2f ms\n", percentile(latenciesMs, 0.50));
+    std::printf("p95           %.2f ms\n", percentile(latenciesMs, 0.95));
+    std::printf("p99           %.2f ms\n", percentile(latenciesMs, 0.99));
+    std::printf("peak RSS      %.1f MiB (bridge and fake sidecar)\n", peakRssKiB() / 1024.0);
+    std::printf("bytes copied  %.0f per request (page/bridge/sidecar hops)\n", static_cast<double>(bytesCopied) / std::max<qsizetype>(1, latenciesMs.size()));
+
+    return exitCode != 0 || failures > 0 ? 1 : 0;
+}
@@ -1,6 +1,7 @@
 // SPDX-FileCopyrightText: 2025 Denys Madureira
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include "core/proxytelemetry.h"
 #include "core/tlsproxybridge.h"
 
 #include <QSignalSpy>
@@ -17,6 +18,9 @@ private Q_SLOTS:
     void fetchRoundTrip();
     void httpErrorStatusIsForwarded();
     void learnsSuccessfulRetryHosts();
+    void compressedPassthroughIsNegotiated();
+    void streamedUploadRoundTrip();
+    void profileEndpointsAreIsolated();
     void unavailableWithoutSidecar();
 };
 
@@ -40,8 +44,10 @@ void TlsProxyBridgeTest::fetchRoundTrip()
     QJsonObject request{{QStringLiteral("url"), QStringLiteral("https://api.example.com/v2/login")},
                         {QStringLiteral("method"), QStringLiteral("POST")},
                         {QStringLiteral("headers"), headers},
-                        {QStringLiteral("bodyBase64"), QString::fromUtf8(QByteArray("{\"email\":\"a@b.c\"}").toBase64())}};
-    bridge.fetchViaProxy(QStringLiteral("req-1"), request);
+                        {QStringLiteral("bodyBase64"), QString::fromUtf8(QByteArray("{\"email\":\"a@b.c\"}").toBase64())},
+                        // Page-supplied, so it must not pick the sidecar session
+                        {QStringLiteral("profile"), QStringLiteral("unify-isolated-other")}};
+    bridge.fetchViaProxy(QStringLiteral("req-1"), request, QStringLiteral("unify-isolated-abc"));
 
     QTRY_VERIFY_WITH_TIMEOUT(server.hasPendingConnections(), 5000);
     QTcpSocket *socket = server.nextPendingConnection();
@@ -53,6 +59,7 @@ void TlsProxyBridgeTest::fetchRoundTrip()
 
     QByteArray targetUrl;
     QByteArray token;
+    QByteArray profile;
     QByteArray authorization;
     int contentLength = -1;
     const QList<QByteArray> lines = raw.left(headerEnd).split('\n');
@@ -68,6 +75,8 @@ void TlsProxyBridgeTest::fetchRoundTrip()
             targetUrl = value;
         } else if (name == "x-unify-token") {
             token = value;
+        } else if (name == "x-unify-profile") {
+            profile = value;
         } else if (name == "authorization") {
             authorization = value;
         } else if (name == "content-length") {
@@ -76,6 +85,7 @@ void TlsProxyBridgeTest::fetchRoundTrip()
     }
     QCOMPARE(targetUrl, QByteArray("https://api.example.com/v2/login"));
     QVERIFY(!token.isEmpty());
+    QCOMPARE(profile, QByteArray("unify-isolated-abc"));
     QCOMPARE(authorization, QByteArray("Bearer token123"));
     QVERIFY(contentLength > 0);
 
@@ -84,7 +94,7 @@ void TlsProxyBridgeTest::fetchRoundTrip()
     QCOMPARE(body, QByteArray("{\"email\":\"a@b.c\"}"));
 
     const QByteArray responseBody = "hello-world";
-    socket->write("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nX-Test-Header: works\r\nContent-Length: " + QByteArray::number(responseBody.size())
+    socket->write("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nX-Test-Header: works\r\nX-Unify-Upstream-Time: 12.5\r\nContent-Length: " + QByteArray::number(responseBody.size())
                   + "\r\n\r\n" + responseBody);
     socket->flush();
 
@@ -97,6 +107,17 @@ void TlsProxyBridgeTest::fetchRoundTrip()
     QCOMPARE(response.value(QStringLiteral("headers")).toObject().value(QStringLiteral("x-test-header")).toString(), QStringLiteral("works"));
     const QByteArray decoded = QByteArray::fromBase64(response.value(QStringLiteral("bodyBase64")).toString().toUtf8());
     QCOMPARE(decoded, QByteArray("hello-world"));
+    // Sidecar bookkeeping headers stay out of the page's view
+    QVERIFY(!response.value(QStringLiteral("headers")).toObject().contains(QStringLiteral("x-unify-upstream-time")));
+
+    ProxyTelemetry *telemetry = bridge.telemetry();
+    QCOMPARE(telemetry->rowCount(), 1);
+    const QModelIndex stats = telemetry->index(0);
+    QCOMPARE(stats.data(ProxyTelemetry::HostRole).toString(), QStringLiteral("api.example.com"));
+    QCOMPARE(stats.data(ProxyTelemetry::Status2xxRole).toLongLong(), qint64(1));
+    QCOMPARE(stats.data(ProxyTelemetry::BytesOutRole).toLongLong(), qint64(17));
+    QCOMPARE(stats.data(ProxyTelemetry::BytesInRole).toLongLong(), qint64(11));
+    QCOMPARE(stats.data(ProxyTelemetry::UpstreamP50Role).toDouble(), 12.5);
 
     socket->disconnectFromHost();
 }
@@ -171,6 +192,126 @@ void TlsProxyBridgeTest::learnsSuccessfulRetryHosts()
     socket->disconnectFromHost();
 }
 
+void TlsProxyBridgeTest::compressedPassthroughIsNegotiated()
+{
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    TlsProxyBridge bridge;
+    bridge.setProxyBaseUrlForTesting(QUrl(QStringLiteral("http://127.0.0.1:%1/").arg(server.serverPort())));
+    bridge.setPreserveCompression(true);
+
+    QSignalSpy spy(&bridge, &TlsProxyBridge::fetchResponse);
+    QJsonObject request{{QStringLiteral("url"), QStringLiteral("https://api.example.com/items/sync")},
+                        {QStringLiteral("method"), QStringLiteral("GET")},
+                        {QStringLiteral("acceptEncoding"), QStringLiteral("gzip, bogus, deflate")}};
+    bridge.fetchViaProxy(QStringLiteral("req-4"), request);
+
+    QTRY_VERIFY_WITH_TIMEOUT(server.hasPendingConnections(), 5000);
+    QTcpSocket *socket = server.nextPendingConnection();
+    QVERIFY(socket);
+
+    QByteArray raw;
+    QTRY_VERIFY_WITH_TIMEOUT((raw += socket->readAll(), raw.indexOf("\r\n\r\n") > 0), 5000);
+    const QByteArray head = raw.left(raw.indexOf("\r\n\r\n")).toLower();
+    QVERIFY(head.contains("x-unify-accept-encoding: gzip, deflate\r\n"));
+    QVERIFY(head.contains("accept-encoding: identity"));
+
+    // The reply must reach the page still compressed, not decoded by Qt
+    const QByteArray compressed("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\x03\x03\x00\x00\x00\x00\x00\x00\x00\x00\x00", 20);
+    socket->write("HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\nContent-Length: " + QByteArray::number(compressed.size()) + "\r\n\r\n" + compressed);
+    socket->flush();
+
+    QVERIFY(spy.wait(5000));
+    const QJsonObject response = spy.takeFirst().at(1).toJsonObject();
+    QCOMPARE(response.value(QStringLiteral("headers")).toObject().value(QStringLiteral("content-encoding")).toString(), QStringLiteral("gzip"));
+    QCOMPARE(QByteArray::fromBase64(response.value(QStringLiteral("bodyBase64")).toString().toUtf8()), compressed);
+
+    socket->disconnectFromHost();
+}
+
+void TlsProxyBridgeTest::streamedUploadRoundTrip()
+{
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    TlsProxyBridge bridge;
+    bridge.setProxyBaseUrlForTesting(QUrl(QStringLiteral("http://127.0.0.1:%1/").arg(server.serverPort())));
+
+    QSignalSpy responseSpy(&bridge, &TlsProxyBridge::fetchResponse);
+    QSignalSpy progressSpy(&bridge, &TlsProxyBridge::uploadProgress);
+    QJsonObject request{{QStringLiteral("url"), QStringLiteral("https://api.example.com/upload")},
+                        {QStringLiteral("method"), QStringLiteral("PUT")},
+                        {QStringLiteral("bodySize"), 12}};
+    bridge.beginUpload(QStringLiteral("req-5"), request);
+    QVERIFY(bridge.appendUploadChunk(QStringLiteral("req-5"), QString::fromLatin1(QByteArray("first-").toBase64())) >= 0);
+
+    QTRY_VERIFY_WITH_TIMEOUT(server.hasPendingConnections(), 5000);
+    QTcpSocket *socket = server.nextPendingConnection();
+    QVERIFY(socket);
+
+    QByteArray raw;
+    QTRY_VERIFY_WITH_TIMEOUT((raw += socket->readAll(), raw.contains("first-")), 5000);
+    const int headerEnd = raw.indexOf("\r\n\r\n");
+    QVERIFY(raw.left(headerEnd).toLower().contains("content-length: 12"));
+
+    // The rest of the body only exists once the page delivers it
+    QVERIFY(bridge.appendUploadChunk(QStringLiteral("req-5"), QString::fromLatin1(QByteArray("second").toBase64())) >= 0);
+    QTRY_VERIFY_WITH_TIMEOUT((raw += socket->readAll(), raw.size() >= headerEnd + 4 + 12), 5000);
+    QCOMPARE(raw.mid(headerEnd + 4), QByteArray("first-second"));
+
+    socket->write("HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n");
+    socket->flush();
+
+    QVERIFY(responseSpy.wait(5000));
+    QCOMPARE(responseSpy.takeFirst().at(1).toJsonObject().value(QStringLiteral("status")).toInt(), 201);
+    QVERIFY(!progressSpy.isEmpty());
+    QCOMPARE(progressSpy.last().at(1).toLongLong(), qint64(12));
+    QCOMPARE(bridge.appendUploadChunk(QStringLiteral("req-5"), QString()), qint64(-1));
+
+    socket->disconnectFromHost();
+}
+
+void TlsProxyBridgeTest::profileEndpointsAreIsolated()
+{
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    TlsProxyBridge bridge;
+    bridge.setProxyBaseUrlForTesting(QUrl(QStringLiteral("http://127.0.0.1:%1/").arg(server.serverPort())));
+
+    TlsProxyProfileBridge *work = bridge.forProfile(QStringLiteral("unify-workspace-work"));
+    TlsProxyProfileBridge *home = bridge.forProfile(QStringLiteral("unify-workspace-home"));
+    QCOMPARE(bridge.forProfile(QStringLiteral("unify-workspace-work")), work);
+    QVERIFY(home != work);
+    QVERIFY(work->proxyReady());
+
+    QSignalSpy workSpy(work, &TlsProxyProfileBridge::fetchResponse);
+    QSignalSpy homeSpy(home, &TlsProxyProfileBridge::fetchResponse);
+    QJsonObject request{{QStringLiteral("url"), QStringLiteral("https://api.example.com/items")},
+                        {QStringLiteral("method"), QStringLiteral("GET")},
+                        {QStringLiteral("profile"), QStringLiteral("unify-workspace-home")}};
+    work->fetchViaProxy(QStringLiteral("req-6"), request);
+
+    QTRY_VERIFY_WITH_TIMEOUT(server.hasPendingConnections(), 5000);
+    QTcpSocket *socket = server.nextPendingConnection();
+    QVERIFY(socket);
+
+    QByteArray raw;
+    QTRY_VERIFY_WITH_TIMEOUT((raw += socket->readAll(), raw.indexOf("\r\n\r\n") > 0), 5000);
+    QVERIFY(raw.toLower().contains("x-unify-profile: unify-workspace-work\r\n"));
+
+    socket->write("HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n");
+    socket->flush();
+
+    // The page gets back the id it chose; the other profile hears nothing
+    QVERIFY(workSpy.wait(5000));
+    QCOMPARE(workSpy.takeFirst().at(0).toString(), QStringLiteral("req-6"));
+    QVERIFY(homeSpy.isEmpty());
+
+    socket->disconnectFromHost();
+}
+
 void TlsProxyBridgeTest::unavailableWithoutSidecar()
 {
     TlsProxyBridge bridge;
@@ -13,6 +13,8 @@
 #include <QJsonObject>
 #include <QUuid>
 
+#include "utils/publicsuffix.h"
+
 // Define special workspace constants
 const QString ConfigManager::FAVORITES_WORKSPACE = QStringLiteral("__favorites__");
 const QString ConfigManager::ALL_SERVICES_WORKSPACE = QStringLiteral("__all_services__");
@@ -55,6 +57,15 @@ bool requestBackgroundPortal(bool autostart)
     }
     return true;
 }
+
+QString originKey(const QUrl &url)
+{
+    QString key = url.scheme() + QStringLiteral("://") + url.host();
+    if (url.port() != -1) {
+        key += QLatin1Char(':') + QString::number(url.port());
+    }
+    return key;
+}
 } // namespace
 
 ConfigManager::ConfigManager(QObject *parent)
@@ -63,6 +74,7 @@ ConfigManager::ConfigManager(QObject *parent)
     , m_currentWorkspace(QStringLiteral("Personal"))
 {
     loadSettings();
+    connect(this, &ConfigManager::servicesChanged, this, &ConfigManager::rebuildServiceOriginIndex);
 }
 
 QVariantList ConfigManager::services() const
@@ -548,6 +560,65 @@ void ConfigManager::setTlsProxyHosts(const QStringList &hosts)
     }
 }
 
+bool ConfigManager::tlsProxyPreserveCompression() const
+{
+    return m_tlsProxyPreserveCompression;
+}
+
+void ConfigManager::setTlsProxyPreserveCompression(bool enabled)
+{
+    if (m_tlsProxyPreserveCompression != enabled) {
+        m_tlsProxyPreserveCompression = enabled;
+        Q_EMIT tlsProxyPreserveCompressionChanged();
+        saveSettings();
+    }
+}
+
+int ConfigManager::iconCacheBudgetMiB() const
+{
+    return m_iconCacheBudgetMiB;
+}
+
+void ConfigManager::setIconCacheBudgetMiB(int mebibytes)
+{
+    mebibytes = qMax(1, mebibytes);
+    if (m_iconCacheBudgetMiB != mebibytes) {
+        m_iconCacheBudgetMiB = mebibytes;
+        Q_EMIT iconCacheBudgetMiBChanged();
+        saveSettings();
+    }
+}
+
+int ConfigManager::notificationBurstSeconds() const
+{
+    return m_notificationBurstSeconds;
+}
+
+void ConfigManager::setNotificationBurstSeconds(int seconds)
+{
+    seconds = qMax(0, seconds);
+    if (m_notificationBurstSeconds != seconds) {
+        m_notificationBurstSeconds = seconds;
+        Q_EMIT notificationBurstSecondsChanged();
+        saveSettings();
+    }
+}
+
+int ConfigManager::notificationRateLimit() const
+{
+    return m_notificationRateLimit;
+}
+
+void ConfigManager::setNotificationRateLimit(int perMinute)
+{
+    perMinute = qMax(0, perMinute);
+    if (m_notificationRateLimit != perMinute) {
+        m_notificationRateLimit = perMinute;
+        Q_EMIT notificationRateLimitChanged();
+        saveSettings();
+    }
+}
+
 void ConfigManager::addService(const QVariantMap &service)
 {
     QVariantMap newService = service;
@@ -649,6 +720,60 @@ void ConfigManager::moveService(int fromIndex, int toIndex)
     qDebug() << "Moved service from index" << fromIndex << "to" << toIndex;
 }
 
+QString ConfigManager::serviceIdForOrigin(const QUrl &origin) const
+{
+    const QString host = origin.host();
+    if (host.isEmpty()) {
+        return QString();
+    }
+    if (const auto it = m_serviceIdByOrigin.constFind(originKey(origin)); it != m_serviceIdByOrigin.constEnd()) {
+        return it.value();
+    }
+
+    // "chat.web.example.com", then "web.example.com", ... up to the registrable
+    // domain. Hosts without one (IP addresses, "localhost") only match exactly.
+    const QString site = PublicSuffix::registrableDomain(host);
+    QString candidate = host;
+    while (true) {
+        if (const auto it = m_serviceIdByHost.constFind(candidate); it != m_serviceIdByHost.constEnd()) {
+            return it.value();
+        }
+        const qsizetype dot = candidate.indexOf(QLatin1Char('.'));
+        if (site.isEmpty() || candidate == site || dot < 0) {
+            break;
+        }
+        candidate = candidate.mid(dot + 1);
+    }
+
+    return site.isEmpty() ? QString() : m_serviceIdBySite.value(site);
+}
+
+void ConfigManager::rebuildServiceOriginIndex()
+{
+    m_serviceIdByOrigin.clear();
+    m_serviceIdByHost.clear();
+    m_serviceIdBySite.clear();
+    for (const QVariant &entry : std::as_const(m_services)) {
+        const QVariantMap service = entry.toMap();
+        const QString serviceId = service.value(QStringLiteral("id")).toString();
+        const QUrl url(service.value(QStringLiteral("url")).toString());
+        if (serviceId.isEmpty() || url.host().isEmpty()) {
+            continue;
+        }
+        const QString origin = originKey(url);
+        if (!m_serviceIdByOrigin.contains(origin)) {
+            m_serviceIdByOrigin.insert(origin, serviceId);
+        }
+        if (!m_serviceIdByHost.contains(url.host())) {
+            m_serviceIdByHost.insert(url.host(), serviceId);
+        }
+        const QString site = PublicSuffix::registrableDomain(url.host());
+        if (!site.isEmpty() && !m_serviceIdBySite.contains(site)) {
+            m_serviceIdBySite.insert(site, serviceId);
+        }
+    }
+}
+
 void ConfigManager::addWorkspace(const QString &workspaceName, bool isolatedStorage)
 {
     if (!workspaceName.isEmpty() && !m_workspaces.contains(workspaceName)) {
@@ -850,6 +975,10 @@ void ConfigManager::saveSettings()
     m_settings.setValue(QStringLiteral("voiceChatService"), m_voiceChatService);
     m_settings.setValue(QStringLiteral("experimentalFeaturesEnabled"), m_experimentalFeaturesEnabled);
     m_settings.setValue(QStringLiteral("tlsProxyHosts"), m_tlsProxyHosts);
+    m_settings.setValue(QStringLiteral("tlsProxyPreserveCompression"), m_tlsProxyPreserveCompression);
+    m_settings.setValue(QStringLiteral("iconCacheBudgetMiB"), m_iconCacheBudgetMiB);
+    m_settings.setValue(QStringLiteral("notificationBurstSeconds"), m_notificationBurstSeconds);
+    m_settings.setValue(QStringLiteral("notificationRateLimit"), m_notificationRateLimit);
     m_settings.endGroup();
 
     m_settings.sync();
@@ -925,8 +1054,14 @@ void ConfigManager::loadSettings()
     m_voiceChatService = m_settings.value(QStringLiteral("voiceChatService"), QStringLiteral("perplexity")).toString();
     m_experimentalFeaturesEnabled = m_settings.value(QStringLiteral("experimentalFeaturesEnabled"), false).toBool();
     m_tlsProxyHosts = m_settings.value(QStringLiteral("tlsProxyHosts"), QStringList{QStringLiteral("api.standardnotes.com")}).toStringList();
+    m_tlsProxyPreserveCompression = m_settings.value(QStringLiteral("tlsProxyPreserveCompression"), true).toBool();
+    m_iconCacheBudgetMiB = qMax(1, m_settings.value(QStringLiteral("iconCacheBudgetMiB"), 100).toInt());
+    m_notificationBurstSeconds = qMax(0, m_settings.value(QStringLiteral("notificationBurstSeconds"), 10).toInt());
+    m_notificationRateLimit = qMax(0, m_settings.value(QStringLiteral("notificationRateLimit"), 10).toInt());
     m_settings.endGroup();
 
+    rebuildServiceOriginIndex();
+
     // Only update workspaces list if it's empty (first run)
     if (m_workspaces.isEmpty()) {
         updateWorkspacesList();
@@ -5,6 +5,7 @@
 #include <QSettings>
 #include <QString>
 #include <QStringList>
+#include <QUrl>
 #include <QVariantList>
 #include <QVariantMap>
 
@@ -32,6 +33,11 @@ class ConfigManager : public QObject
     Q_PROPERTY(QString voiceChatService READ voiceChatService WRITE setVoiceChatService NOTIFY voiceChatServiceChanged)
     Q_PROPERTY(bool experimentalFeaturesEnabled READ experimentalFeaturesEnabled WRITE setExperimentalFeaturesEnabled NOTIFY experimentalFeaturesEnabledChanged)
     Q_PROPERTY(QStringList tlsProxyHosts READ tlsProxyHosts WRITE setTlsProxyHosts NOTIFY tlsProxyHostsChanged)
+    Q_PROPERTY(bool tlsProxyPreserveCompression READ tlsProxyPreserveCompression WRITE setTlsProxyPreserveCompression NOTIFY
+                   tlsProxyPreserveCompressionChanged)
+    Q_PROPERTY(int iconCacheBudgetMiB READ iconCacheBudgetMiB WRITE setIconCacheBudgetMiB NOTIFY iconCacheBudgetMiBChanged)
+    Q_PROPERTY(int notificationBurstSeconds READ notificationBurstSeconds WRITE setNotificationBurstSeconds NOTIFY notificationBurstSecondsChanged)
+    Q_PROPERTY(int notificationRateLimit READ notificationRateLimit WRITE setNotificationRateLimit NOTIFY notificationRateLimitChanged)
 
 public:
     explicit ConfigManager(QObject *parent = nullptr);
@@ -49,6 +55,11 @@ public:
     Q_INVOKABLE void removeService(const QString &serviceId);
     Q_INVOKABLE void moveService(int fromIndex, int toIndex);
 
+    // Service a web origin belongs to, for routing notifications and permission
+    // requests: same origin first, then same host, a parent host and finally the
+    // same registrable domain. Empty if no service matches.
+    Q_INVOKABLE QString serviceIdForOrigin(const QUrl &origin) const;
+
     Q_INVOKABLE void addWorkspace(const QString &workspaceName, bool isolatedStorage = false);
     Q_INVOKABLE void removeWorkspace(const QString &workspaceName);
     Q_INVOKABLE void renameWorkspace(const QString &oldName, const QString &newName);
@@ -133,6 +144,24 @@ public:
     QStringList tlsProxyHosts() const;
     void setTlsProxyHosts(const QStringList &hosts);
 
+    // Keep proxied response bodies compressed until the page decodes them
+    bool tlsProxyPreserveCompression() const;
+    void setTlsProxyPreserveCompression(bool enabled);
+
+    // Disk space for cached favicons and service images, in MiB
+    int iconCacheBudgetMiB() const;
+    void setIconCacheBudgetMiB(int mebibytes);
+
+    // A service's notifications arriving this close together update the one
+    // on screen instead of stacking up; 0 disables merging
+    int notificationBurstSeconds() const;
+    void setNotificationBurstSeconds(int seconds);
+
+    // New notifications each service may pop up per minute; messages over it
+    // are shown together once the minute allows. 0 is unlimited.
+    int notificationRateLimit() const;
+    void setNotificationRateLimit(int perMinute);
+
     Q_INVOKABLE void saveSettings();
     Q_INVOKABLE void loadSettings();
 
@@ -182,15 +211,25 @@ Q_SIGNALS:
     void voiceChatServiceChanged();
     void experimentalFeaturesEnabledChanged();
     void tlsProxyHostsChanged();
+    void tlsProxyPreserveCompressionChanged();
+    void iconCacheBudgetMiBChanged();
+    void notificationBurstSecondsChanged();
+    void notificationRateLimitChanged();
 
 private:
     void updateWorkspacesList();
+    void rebuildServiceOriginIndex();
 
     QSettings m_settings;
     QVariantList m_services;
     QStringList m_workspaces;
     QString m_currentWorkspace;
     QHash<QString, QString> m_lastServiceByWorkspace; // workspace -> serviceId
+    // serviceIdForOrigin() lookups, rebuilt whenever services change. The
+    // first service in list order owns a shared key.
+    QHash<QString, QString> m_serviceIdByOrigin; // "scheme://host[:port]" -> serviceId
+    QHash<QString, QString> m_serviceIdByHost; // host -> serviceId
+    QHash<QString, QString> m_serviceIdBySite; // registrable domain -> serviceId
     QHash<QString, QString> m_workspaceIcons; // workspace -> icon name
     QHash<QString, bool> m_workspaceIsolatedStorage; // workspace -> isolated storage flag
     QVariantMap m_disabledWorkspaces; // workspace name -> bool (true if disabled)
@@ -209,6 +248,10 @@ private:
     QString m_voiceChatService = QStringLiteral("perplexity");
     bool m_experimentalFeaturesEnabled = false;
     QStringList m_tlsProxyHosts;
+    bool m_tlsProxyPreserveCompression = true;
+    int m_iconCacheBudgetMiB = 100;
+    int m_notificationBurstSeconds = 10;
+    int m_notificationRateLimit = 10;
 };
 
 #endif // CONFIGMANAGER_H
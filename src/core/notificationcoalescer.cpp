@@ -0,0 +1,85 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "notificationcoalescer.h"
+
+#include <utility>
+
+namespace
+{
+constexpr qint64 RATE_PERIOD_MS = 60 * 1000;
+}
+
+void NotificationCoalescer::setBurstWindow(qint64 msecs)
+{
+    m_burstWindow = qMax<qint64>(0, msecs);
+}
+
+void NotificationCoalescer::setRateLimit(int perMinute)
+{
+    m_rateLimit = qMax(0, perMinute);
+}
+
+NotificationCoalescer::Decision NotificationCoalescer::add(const QString &key, qint64 now, bool active)
+{
+    KeyState &state = m_keys[key];
+    ++state.unseen;
+    const Decision decision = admit(state, now, active);
+    if (decision == Suppress) {
+        ++m_stats.suppressed;
+    }
+    return decision;
+}
+
+NotificationCoalescer::Decision NotificationCoalescer::flush(const QString &key, qint64 now, bool active)
+{
+    auto it = m_keys.find(key);
+    if (it == m_keys.end() || it->unseen == 0) {
+        return Suppress;
+    }
+    return admit(*it, now, active);
+}
+
+NotificationCoalescer::Decision NotificationCoalescer::admit(KeyState &state, qint64 now, bool active)
+{
+    // The window slides: a steady stream keeps updating the same notification
+    const bool merge = active && state.count > 0 && m_burstWindow > 0 && now - state.lastShownAt < m_burstWindow;
+    if (!merge) {
+        while (!state.shownAt.isEmpty() && now - state.shownAt.constFirst() >= RATE_PERIOD_MS) {
+            state.shownAt.removeFirst();
+        }
+        if (m_rateLimit > 0 && state.shownAt.size() >= m_rateLimit) {
+            return Suppress;
+        }
+        state.shownAt.append(now);
+    }
+
+    state.count = (merge ? state.count : 0) + std::exchange(state.unseen, 0);
+    state.lastShownAt = now;
+    if (merge) {
+        ++m_stats.merged;
+        return Merge;
+    }
+    ++m_stats.shown;
+    return Show;
+}
+
+qint64 NotificationCoalescer::flushAt(const QString &key) const
+{
+    const auto it = m_keys.constFind(key);
+    if (it == m_keys.cend() || it->unseen == 0) {
+        return -1;
+    }
+    // Messages only wait while the minute is full; its oldest entry frees it
+    return it->shownAt.isEmpty() ? 0 : it->shownAt.constFirst() + RATE_PERIOD_MS;
+}
+
+int NotificationCoalescer::count(const QString &key) const
+{
+    return m_keys.value(key).count;
+}
+
+NotificationCoalescer::Stats NotificationCoalescer::stats() const
+{
+    return m_stats;
+}
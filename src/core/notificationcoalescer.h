@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NOTIFICATIONCOALESCER_H
+#define NOTIFICATIONCOALESCER_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Decides, per service, whether a web notification pops up on its own, is
+// folded into the one still on screen, or waits because the service hit its
+// rate cap. Waiting messages are not lost: flush() shows them, counted
+// together, once the cap allows. Pure bookkeeping on caller-supplied
+// monotonic timestamps; the presenter owns the actual KNotifications.
+class NotificationCoalescer
+{
+public:
+    enum Decision {
+        Show, // new notification
+        Merge, // update the one on screen in place
+        Suppress, // over the rate cap; waits for the next one shown or flush()
+    };
+
+    struct Stats {
+        qint64 shown = 0;
+        qint64 merged = 0;
+        qint64 suppressed = 0;
+    };
+
+    // Arrivals closer together than this, while the previous one is still on
+    // screen, are merged; 0 disables merging
+    void setBurstWindow(qint64 msecs);
+    // New notifications per service per minute; updating the one on screen
+    // doesn't count. 0 is unlimited.
+    void setRateLimit(int perMinute);
+
+    // active: whether this key's last notification is still on screen
+    Decision add(const QString &key, qint64 now, bool active);
+    // Shows the messages waiting for key if the cap allows now; Suppress if
+    // it doesn't or nothing is waiting
+    Decision flush(const QString &key, qint64 now, bool active);
+    // When flush() can succeed for key, or -1 if nothing is waiting
+    qint64 flushAt(const QString &key) const;
+    // Messages the key's latest notification stands for, merged and
+    // suppressed ones included
+    int count(const QString &key) const;
+    Stats stats() const;
+
+private:
+    struct KeyState {
+        qint64 lastShownAt = 0;
+        int count = 0;
+        // Arrived since something was last shown
+        int unseen = 0;
+        // New notifications within the last minute, oldest first
+        QList<qint64> shownAt;
+    };
+
+    Decision admit(KeyState &state, qint64 now, bool active);
+
+    qint64 m_burstWindow = 0;
+    int m_rateLimit = 0;
+    QHash<QString, KeyState> m_keys;
+    Stats m_stats;
+};
+
+#endif // NOTIFICATIONCOALESCER_H
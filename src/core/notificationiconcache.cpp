@@ -0,0 +1,56 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "notificationiconcache.h"
+
+#include <QHashFunctions>
+
+NotificationIconCache::NotificationIconCache(int iconSize, qint64 byteBudget)
+    : m_iconSize(qMax(1, iconSize))
+    , m_pixmaps(byteBudget)
+{
+}
+
+size_t NotificationIconCache::contentKey(const QImage &image)
+{
+    size_t key = qHashMulti(0, image.width(), image.height(), int(image.format()));
+    // Row by row: padding at the end of a scan line is not part of the image
+    const qsizetype rowBytes = (qsizetype(image.width()) * image.depth() + 7) / 8;
+    for (int y = 0; y < image.height(); ++y) {
+        key = qHashBits(image.constScanLine(y), rowBytes, key);
+    }
+    return key;
+}
+
+QPixmap NotificationIconCache::pixmap(const QImage &icon)
+{
+    if (icon.isNull()) {
+        return QPixmap();
+    }
+
+    const size_t key = contentKey(icon);
+    if (const QPixmap *cached = m_pixmaps.object(key)) {
+        ++m_stats.hits;
+        return *cached;
+    }
+    ++m_stats.misses;
+
+    QImage scaled = icon;
+    if (icon.width() > m_iconSize || icon.height() > m_iconSize) {
+        scaled = icon.scaled(m_iconSize, m_iconSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    auto *pixmap = new QPixmap(QPixmap::fromImage(scaled));
+    const QPixmap result = *pixmap;
+    m_pixmaps.insert(key, pixmap, qMax<qint64>(1, qint64(pixmap->width()) * pixmap->height() * 4));
+    return result;
+}
+
+int NotificationIconCache::iconSize() const
+{
+    return m_iconSize;
+}
+
+NotificationIconCache::Stats NotificationIconCache::stats() const
+{
+    return m_stats;
+}
@@ -0,0 +1,39 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NOTIFICATIONICONCACHE_H
+#define NOTIFICATIONICONCACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QPixmap>
+
+// Web notification icons converted once, already shrunk to what the
+// notification server displays. Keyed by pixel content, since every
+// notification carries a fresh QImage even when a sender's avatar hasn't
+// changed; capped by pixmap bytes, least recently used dropped first.
+class NotificationIconCache
+{
+public:
+    struct Stats {
+        qint64 hits = 0;
+        qint64 misses = 0;
+    };
+
+    // iconSize: longest side in device pixels; larger icons are scaled down
+    explicit NotificationIconCache(int iconSize, qint64 byteBudget = 4 * 1024 * 1024);
+
+    // Null for a null image
+    QPixmap pixmap(const QImage &icon);
+    int iconSize() const;
+    Stats stats() const;
+
+    static size_t contentKey(const QImage &image);
+
+private:
+    int m_iconSize;
+    QCache<size_t, QPixmap> m_pixmaps;
+    Stats m_stats;
+};
+
+#endif // NOTIFICATIONICONCACHE_H
@@ -2,46 +2,61 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "notificationpresenter.h"
+#include <KLocalizedString>
 #include <KNotification>
 #include <QDebug>
+#include <QGuiApplication>
 #include <QImage>
 #include <QPixmap>
 #include <QWebEngineNotification>
 
+namespace
+{
+// Logical pixels; enough for the image slot of common notification popups
+constexpr int NOTIFICATION_ICON_SIZE = 64;
+
+int notificationIconSize()
+{
+    const qreal ratio = qGuiApp ? qGuiApp->devicePixelRatio() : 1.0;
+    return qRound(NOTIFICATION_ICON_SIZE * ratio);
+}
+}
+
 NotificationPresenter::NotificationPresenter(QObject *parent)
     : QObject(parent)
+    , m_icons(notificationIconSize())
 {
+    m_clock.start();
+    m_flushTimer.setSingleShot(true);
+    connect(&m_flushTimer, &QTimer::timeout, this, &NotificationPresenter::flushWaiting);
 }
 
-void NotificationPresenter::presentFromQmlWithNotification(QWebEngineNotification *webNotification, const QString &serviceId)
+void NotificationPresenter::setBurstWindow(qint64 msecs)
 {
-    if (!webNotification) {
-        qDebug() << "❌ presentFromQmlWithNotification called with null notification";
-        return;
-    }
+    m_coalescer.setBurstWindow(msecs);
+}
 
-    QString title = webNotification->title().isEmpty() ? QStringLiteral("Web Notification") : webNotification->title();
-    QString message = webNotification->message();
-    QImage icon = webNotification->icon();
+void NotificationPresenter::setRateLimit(int perMinute)
+{
+    m_coalescer.setRateLimit(perMinute);
+}
 
-    qDebug() << "📢 QML-present notification (with icon):";
-    qDebug() << "   Title:" << title;
-    qDebug() << "   Message:" << message;
-    qDebug() << "   Origin:" << webNotification->origin().host();
-    qDebug() << "   Service ID:" << serviceId;
-    qDebug() << "   Has icon:" << !icon.isNull() << (icon.isNull() ? QStringLiteral("") : QStringLiteral("(%1x%2)").arg(icon.width()).arg(icon.height()));
+QVariantMap NotificationPresenter::stats() const
+{
+    const NotificationCoalescer::Stats stats = m_coalescer.stats();
+    return {
+        {QStringLiteral("shown"), stats.shown},
+        {QStringLiteral("merged"), stats.merged},
+        {QStringLiteral("suppressed"), stats.suppressed},
+        {QStringLiteral("iconHits"), m_icons.stats().hits},
+        {QStringLiteral("iconMisses"), m_icons.stats().misses},
+    };
+}
 
+KNotification *NotificationPresenter::createNotification(const QString &serviceId)
+{
     auto *notification = new KNotification(QStringLiteral("notification"), KNotification::CloseOnTimeout, this);
     notification->setComponentName(QStringLiteral("unify"));
-    notification->setTitle(title);
-    notification->setText(message);
-
-    // Use the icon from the web notification if available, otherwise use default icon
-    if (!icon.isNull()) {
-        notification->setPixmap(QPixmap::fromImage(icon));
-    } else {
-        notification->setIconName(QStringLiteral("dialog-information"));
-    }
 
     // Add a default action that will be triggered when the notification is clicked
     KNotificationAction *defaultAction = notification->addDefaultAction(QStringLiteral("Open"));
@@ -54,7 +69,111 @@ void NotificationPresenter::presentFromQmlWithNotification(QWebEngineNotificatio
         }
     });
 
-    notification->sendEvent();
+    return notification;
+}
+
+void NotificationPresenter::show(const QString &serviceId, const QString &originHost, const QString &title, const QString &message, const QImage &icon)
+{
+    // Notifications without a service are grouped by the site that sent them
+    const QString key = serviceId.isEmpty() ? originHost : serviceId;
+    const NotificationCoalescer::Decision decision = m_coalescer.add(key, m_clock.elapsed(), !m_active.value(key).isNull());
+    Q_EMIT statsChanged();
+
+    if (decision == NotificationCoalescer::Suppress) {
+        qDebug() << "   Delayed: rate limit reached for" << key;
+        m_waiting.insert(key, Message{serviceId, title, message, icon});
+        scheduleFlush();
+        return;
+    }
+
+    // Anything that was waiting is counted into this one
+    m_waiting.remove(key);
+    display(key, decision, Message{serviceId, title, message, icon});
+}
+
+void NotificationPresenter::flushWaiting()
+{
+    const qint64 now = m_clock.elapsed();
+    for (auto it = m_waiting.begin(); it != m_waiting.end();) {
+        const NotificationCoalescer::Decision decision = m_coalescer.flush(it.key(), now, !m_active.value(it.key()).isNull());
+        if (decision == NotificationCoalescer::Suppress) {
+            ++it;
+            continue;
+        }
+        display(it.key(), decision, it.value());
+        it = m_waiting.erase(it);
+    }
+    Q_EMIT statsChanged();
+    scheduleFlush();
+}
+
+void NotificationPresenter::scheduleFlush()
+{
+    qint64 next = -1;
+    for (auto it = m_waiting.cbegin(); it != m_waiting.cend(); ++it) {
+        const qint64 at = m_coalescer.flushAt(it.key());
+        if (at >= 0 && (next < 0 || at < next)) {
+            next = at;
+        }
+    }
+    if (next < 0) {
+        m_flushTimer.stop();
+        return;
+    }
+    m_flushTimer.start(int(qMax<qint64>(0, next - m_clock.elapsed())));
+}
+
+void NotificationPresenter::display(const QString &key, NotificationCoalescer::Decision decision, const Message &message)
+{
+    QPointer<KNotification> &active = m_active[key];
+    const int count = m_coalescer.count(key);
+    KNotification *notification = decision == NotificationCoalescer::Merge ? active.data() : createNotification(message.serviceId);
+    notification->setTitle(count > 1 ? i18ncp("@title notification, %2 is the latest message's title", "%2 (%1 new message)", "%2 (%1 new messages)", count, message.title)
+                                     : message.title);
+    notification->setText(message.message);
+
+    // Use the icon from the web notification if available, otherwise use default icon
+    if (!message.icon.isNull()) {
+        // Repeated avatars come back as the same pixmap; a merged notification
+        // that already shows it is left alone
+        const QPixmap pixmap = m_icons.pixmap(message.icon);
+        if (pixmap.cacheKey() != notification->pixmap().cacheKey()) {
+            notification->setPixmap(pixmap);
+        }
+        Q_EMIT statsChanged();
+    } else if (decision == NotificationCoalescer::Show) {
+        notification->setIconName(QStringLiteral("dialog-information"));
+    }
+
+    // A merged notification is already on screen; KNotification pushes the
+    // property changes above to the server itself
+    if (decision == NotificationCoalescer::Show) {
+        notification->sendEvent();
+        active = notification;
+    } else {
+        qDebug() << "   Merged into the notification on screen (" << count << "messages )";
+    }
+}
+
+void NotificationPresenter::presentFromQmlWithNotification(QWebEngineNotification *webNotification, const QString &serviceId)
+{
+    if (!webNotification) {
+        qDebug() << "❌ presentFromQmlWithNotification called with null notification";
+        return;
+    }
+
+    QString title = webNotification->title().isEmpty() ? QStringLiteral("Web Notification") : webNotification->title();
+    QString message = webNotification->message();
+    QImage icon = webNotification->icon();
+
+    qDebug() << "📢 QML-present notification (with icon):";
+    qDebug() << "   Title:" << title;
+    qDebug() << "   Message:" << message;
+    qDebug() << "   Origin:" << webNotification->origin().host();
+    qDebug() << "   Service ID:" << serviceId;
+    qDebug() << "   Has icon:" << !icon.isNull() << (icon.isNull() ? QStringLiteral("") : QStringLiteral("(%1x%2)").arg(icon.width()).arg(icon.height()));
+
+    show(serviceId, webNotification->origin().host(), title, message, icon);
 
     // Close the web notification
     webNotification->close();
@@ -71,24 +190,7 @@ void NotificationPresenter::presentFromQml(const QString &titleIn, const QString
     qDebug() << "   Origin:" << originUrl.host();
     qDebug() << "   Service ID:" << serviceId;
 
-    auto *notification = new KNotification(QStringLiteral("notification"), KNotification::CloseOnTimeout, this);
-    notification->setComponentName(QStringLiteral("unify"));
-    notification->setTitle(title);
-    notification->setText(message);
-    notification->setIconName(QStringLiteral("dialog-information"));
-
-    // Add a default action that will be triggered when the notification is clicked
-    KNotificationAction *defaultAction = notification->addDefaultAction(QStringLiteral("Open"));
-
-    // Connect the action's activated signal to emit our notificationClicked signal
-    connect(defaultAction, &KNotificationAction::activated, this, [this, serviceId]() {
-        qDebug() << "📢 Notification clicked for service:" << serviceId;
-        if (!serviceId.isEmpty()) {
-            Q_EMIT notificationClicked(serviceId);
-        }
-    });
-
-    notification->sendEvent();
+    show(serviceId, originUrl.host(), title, message);
 }
 
 void NotificationPresenter::present(std::unique_ptr<QWebEngineNotification> notification, const QString &serviceId)
@@ -107,24 +209,7 @@ void NotificationPresenter::present(std::unique_ptr<QWebEngineNotification> noti
     qDebug() << "   Origin:" << notification->origin().host();
     qDebug() << "   Service ID:" << serviceId;
 
-    auto *knotification = new KNotification(QStringLiteral("notification"), KNotification::CloseOnTimeout, this);
-    knotification->setComponentName(QStringLiteral("unify"));
-    knotification->setTitle(title);
-    knotification->setText(message);
-    knotification->setIconName(QStringLiteral("dialog-information"));
-
-    // Add a default action that will be triggered when the notification is clicked
-    KNotificationAction *defaultAction = knotification->addDefaultAction(QStringLiteral("Open"));
-
-    // Connect the action's activated signal to emit our notificationClicked signal
-    connect(defaultAction, &KNotificationAction::activated, this, [this, serviceId]() {
-        qDebug() << "📢 Notification clicked for service:" << serviceId;
-        if (!serviceId.isEmpty()) {
-            Q_EMIT notificationClicked(serviceId);
-        }
-    });
-
-    knotification->sendEvent();
+    show(serviceId, notification->origin().host(), title, message);
 
     notification->close();
-}
\ No newline at end of file
+}
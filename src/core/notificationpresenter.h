@@ -4,20 +4,43 @@
 #ifndef NOTIFICATIONPRESENTER_H
 #define NOTIFICATIONPRESENTER_H
 
+#include "notificationcoalescer.h"
+#include "notificationiconcache.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
 #include <QObject>
+#include <QPointer>
 #include <QString>
+#include <QTimer>
 #include <QUrl>
+#include <QVariantMap>
 #include <memory>
 
+class KNotification;
 class QWebEngineNotification;
 
+// Bursts from one service are folded into the notification already on
+// screen, updated in place, and each service's new notifications are capped
+// per minute. Messages over the cap are shown, counted together with the
+// latest one's text, as soon as the minute allows; see NotificationCoalescer
 class NotificationPresenter : public QObject
 {
     Q_OBJECT
+    // shown, merged and suppressed (delayed by the rate cap) notifications
+    // since startup, plus iconHits and iconMisses
+    Q_PROPERTY(QVariantMap stats READ stats NOTIFY statsChanged)
 
 public:
     explicit NotificationPresenter(QObject *parent = nullptr);
 
+    // 0 disables merging
+    void setBurstWindow(qint64 msecs);
+    // Per service; 0 is unlimited
+    void setRateLimit(int perMinute);
+    QVariantMap stats() const;
+
     // Present notification from QML with QWebEngineNotification object (includes icon)
     Q_INVOKABLE void presentFromQmlWithNotification(QWebEngineNotification *webNotification, const QString &serviceId);
 
@@ -28,6 +51,31 @@ public:
 
 Q_SIGNALS:
     void notificationClicked(const QString &serviceId);
+    void statsChanged();
+
+private:
+    struct Message {
+        QString serviceId;
+        QString title;
+        QString message;
+        QImage icon;
+    };
+
+    void show(const QString &serviceId, const QString &originHost, const QString &title, const QString &message, const QImage &icon = QImage());
+    void display(const QString &key, NotificationCoalescer::Decision decision, const Message &message);
+    void flushWaiting();
+    void scheduleFlush();
+    KNotification *createNotification(const QString &serviceId);
+
+    NotificationCoalescer m_coalescer;
+    NotificationIconCache m_icons;
+    QElapsedTimer m_clock;
+    // Latest notification per coalescing key, while it's on screen
+    QHash<QString, QPointer<KNotification>> m_active;
+    // Latest message per key delayed by the rate cap, and the timer that
+    // shows it once the cap allows
+    QHash<QString, Message> m_waiting;
+    QTimer m_flushTimer;
 };
 
 #endif // NOTIFICATIONPRESENTER_H
\ No newline at end of file
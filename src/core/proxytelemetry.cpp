@@ -0,0 +1,239 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "proxytelemetry.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtAlgorithms>
+
+#include <cmath>
+
+namespace
+{
+double toMillis(qint64 micros)
+{
+    return micros / 1000.0;
+}
+
+QJsonObject phaseJson(const LatencyHistogram &histogram)
+{
+    return {{QStringLiteral("count"), histogram.count()},
+            {QStringLiteral("p50"), toMillis(histogram.percentile(0.50))},
+            {QStringLiteral("p95"), toMillis(histogram.percentile(0.95))},
+            {QStringLiteral("p99"), toMillis(histogram.percentile(0.99))},
+            {QStringLiteral("max"), toMillis(histogram.max())}};
+}
+}
+
+void LatencyHistogram::record(qint64 micros)
+{
+    micros = qBound<qint64>(0, micros, (qint64(1) << MAX_EXPONENT) - 1);
+    ++m_counts[bucketFor(micros)];
+    ++m_count;
+    m_max = qMax(m_max, micros);
+}
+
+void LatencyHistogram::reset()
+{
+    m_counts.fill(0);
+    m_count = 0;
+    m_max = 0;
+}
+
+qint64 LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+qint64 LatencyHistogram::max() const
+{
+    return m_max;
+}
+
+qint64 LatencyHistogram::percentile(double fraction) const
+{
+    if (m_count == 0) {
+        return 0;
+    }
+    const qint64 rank = qMax<qint64>(1, qint64(std::ceil(qBound(0.0, fraction, 1.0) * m_count)));
+    qint64 seen = 0;
+    for (int bucket = 0; bucket < BUCKETS; ++bucket) {
+        seen += m_counts[bucket];
+        if (seen >= rank) {
+            return qMin(bucketUpperBound(bucket), m_max);
+        }
+    }
+    return m_max;
+}
+
+int LatencyHistogram::bucketFor(qint64 micros)
+{
+    if (micros < SUB_BUCKETS) {
+        return int(micros);
+    }
+    const int exponent = 63 - qCountLeadingZeroBits(quint64(micros));
+    const int shift = exponent - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + int(micros >> shift) - SUB_BUCKETS;
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int bucket)
+{
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const int shift = bucket / SUB_BUCKETS - 1;
+    const qint64 lower = qint64(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + (qint64(1) << shift) - 1;
+}
+
+ProxyTelemetry::ProxyTelemetry(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int ProxyTelemetry::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_hosts.size());
+}
+
+QVariant ProxyTelemetry::data(const QModelIndex &index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid | CheckIndexOption::ParentIsInvalid)) {
+        return QVariant();
+    }
+    const HostStats &stats = m_hosts.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case HostRole:
+        return stats.host;
+    case RequestsRole:
+        return stats.requests;
+    case FailuresRole:
+        return stats.failures;
+    case Status2xxRole:
+        return stats.statusClasses[1];
+    case Status3xxRole:
+        return stats.statusClasses[2];
+    case Status4xxRole:
+        return stats.statusClasses[3];
+    case Status5xxRole:
+        return stats.statusClasses[4];
+    case BytesInRole:
+        return stats.bytesIn;
+    case BytesOutRole:
+        return stats.bytesOut;
+    case TotalP50Role:
+        return toMillis(stats.total.percentile(0.50));
+    case TotalP95Role:
+        return toMillis(stats.total.percentile(0.95));
+    case TotalP99Role:
+        return toMillis(stats.total.percentile(0.99));
+    case QueueP50Role:
+        return toMillis(stats.queue.percentile(0.50));
+    case SidecarP50Role:
+        return toMillis(stats.sidecar.percentile(0.50));
+    case UpstreamP50Role:
+        return toMillis(stats.upstream.percentile(0.50));
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> ProxyTelemetry::roleNames() const
+{
+    return {
+        {HostRole, "host"},
+        {RequestsRole, "requests"},
+        {FailuresRole, "failures"},
+        {Status2xxRole, "status2xx"},
+        {Status3xxRole, "status3xx"},
+        {Status4xxRole, "status4xx"},
+        {Status5xxRole, "status5xx"},
+        {BytesInRole, "bytesIn"},
+        {BytesOutRole, "bytesOut"},
+        {TotalP50Role, "totalP50"},
+        {TotalP95Role, "totalP95"},
+        {TotalP99Role, "totalP99"},
+        {QueueP50Role, "queueP50"},
+        {SidecarP50Role, "sidecarP50"},
+        {UpstreamP50Role, "upstreamP50"},
+    };
+}
+
+void ProxyTelemetry::record(const Sample &sample)
+{
+    int row = m_rows.value(sample.host, -1);
+    if (row < 0) {
+        row = int(m_hosts.size());
+        beginInsertRows(QModelIndex(), row, row);
+        HostStats stats;
+        stats.host = sample.host;
+        m_hosts.append(stats);
+        m_rows.insert(sample.host, row);
+        endInsertRows();
+    }
+
+    HostStats &stats = m_hosts[row];
+    ++stats.requests;
+    if (sample.status <= 0) {
+        ++stats.failures;
+    } else {
+        ++stats.statusClasses[qBound(1, sample.status / 100, 5) - 1];
+    }
+    stats.bytesIn += sample.bytesIn;
+    stats.bytesOut += sample.bytesOut;
+    if (sample.queueMicros >= 0) {
+        stats.queue.record(sample.queueMicros);
+    }
+    if (sample.sidecarMicros >= 0) {
+        stats.sidecar.record(sample.sidecarMicros);
+    }
+    if (sample.upstreamMicros >= 0) {
+        stats.upstream.record(sample.upstreamMicros);
+    }
+    stats.total.record(sample.totalMicros);
+
+    const QModelIndex changed = index(row);
+    Q_EMIT dataChanged(changed, changed);
+}
+
+QStringList ProxyTelemetry::hosts() const
+{
+    QStringList result;
+    result.reserve(m_hosts.size());
+    for (const HostStats &stats : m_hosts) {
+        result.append(stats.host);
+    }
+    return result;
+}
+
+QString ProxyTelemetry::statsJson() const
+{
+    QJsonObject result;
+    for (const HostStats &stats : m_hosts) {
+        const QJsonObject statusClasses{{QStringLiteral("1xx"), stats.statusClasses[0]},
+                                        {QStringLiteral("2xx"), stats.statusClasses[1]},
+                                        {QStringLiteral("3xx"), stats.statusClasses[2]},
+                                        {QStringLiteral("4xx"), stats.statusClasses[3]},
+                                        {QStringLiteral("5xx"), stats.statusClasses[4]}};
+        result.insert(stats.host,
+                      QJsonObject{{QStringLiteral("requests"), stats.requests},
+                                  {QStringLiteral("failures"), stats.failures},
+                                  {QStringLiteral("status"), statusClasses},
+                                  {QStringLiteral("bytesIn"), stats.bytesIn},
+                                  {QStringLiteral("bytesOut"), stats.bytesOut},
+                                  {QStringLiteral("queue"), phaseJson(stats.queue)},
+                                  {QStringLiteral("sidecar"), phaseJson(stats.sidecar)},
+                                  {QStringLiteral("upstream"), phaseJson(stats.upstream)},
+                                  {QStringLiteral("total"), phaseJson(stats.total)}});
+    }
+    return QString::fromUtf8(QJsonDocument(result).toJson(QJsonDocument::Compact));
+}
+
+void ProxyTelemetry::reset()
+{
+    beginResetModel();
+    m_hosts.clear();
+    m_rows.clear();
+    endResetModel();
+}
@@ -0,0 +1,115 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PROXYTELEMETRY_H
+#define PROXYTELEMETRY_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+
+#include <array>
+
+// HDR-style latency histogram in microseconds: each power of two is split into
+// 16 linear buckets, so percentiles are accurate to ~6% at any magnitude while
+// recording stays O(1) with a fixed footprint
+class LatencyHistogram
+{
+public:
+    void record(qint64 micros);
+    void reset();
+
+    qint64 count() const;
+    qint64 max() const;
+    // Upper bound of the bucket holding the given fraction (0..1) of samples
+    qint64 percentile(double fraction) const;
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    // 2^36 us is about 19 hours, far beyond any request timeout
+    static constexpr int MAX_EXPONENT = 36;
+    static constexpr int BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static int bucketFor(qint64 micros);
+    static qint64 bucketUpperBound(int bucket);
+
+    std::array<quint32, BUCKETS> m_counts{};
+    qint64 m_count = 0;
+    qint64 m_max = 0;
+};
+
+// Per-host TlsProxyBridge statistics, one row per target host. Read by the
+// Settings > Network page and exported on D-Bus (io.github.denysmb.Unify.TlsProxy)
+// for scripting.
+class ProxyTelemetry : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "io.github.denysmb.Unify.TlsProxy")
+
+public:
+    enum Roles {
+        HostRole = Qt::UserRole + 1,
+        RequestsRole,
+        FailuresRole,
+        Status2xxRole,
+        Status3xxRole,
+        Status4xxRole,
+        Status5xxRole,
+        BytesInRole,
+        BytesOutRole,
+        TotalP50Role,
+        TotalP95Role,
+        TotalP99Role,
+        QueueP50Role,
+        SidecarP50Role,
+        UpstreamP50Role,
+    };
+    Q_ENUM(Roles)
+
+    // One finished request. Phases are in microseconds, -1 when unknown;
+    // status 0 means no HTTP response (sidecar unreachable, timeout, abort).
+    struct Sample {
+        QString host;
+        int status = 0;
+        qint64 queueMicros = -1;
+        qint64 sidecarMicros = -1;
+        qint64 upstreamMicros = -1;
+        qint64 totalMicros = 0;
+        qint64 bytesOut = 0;
+        qint64 bytesIn = 0;
+    };
+
+    explicit ProxyTelemetry(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    void record(const Sample &sample);
+
+public Q_SLOTS:
+    Q_SCRIPTABLE QStringList hosts() const;
+    // Every counter and the p50/p95/p99/max of each phase (milliseconds), keyed by host
+    Q_SCRIPTABLE QString statsJson() const;
+    Q_SCRIPTABLE void reset();
+
+private:
+    struct HostStats {
+        QString host;
+        qint64 requests = 0;
+        qint64 failures = 0;
+        std::array<qint64, 5> statusClasses{};
+        qint64 bytesIn = 0;
+        qint64 bytesOut = 0;
+        LatencyHistogram queue;
+        LatencyHistogram sidecar;
+        LatencyHistogram upstream;
+        LatencyHistogram total;
+    };
+
+    QList<HostStats> m_hosts;
+    QHash<QString, int> m_rows;
+};
+
+#endif // PROXYTELEMETRY_H
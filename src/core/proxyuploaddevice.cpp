@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "proxyuploaddevice.h"
+
+#include <cstring>
+
+ProxyUploadDevice::ProxyUploadDevice(qint64 totalSize, QObject *parent)
+    : QIODevice(parent)
+    , m_totalSize(totalSize)
+{
+}
+
+void ProxyUploadDevice::append(const QByteArray &chunk)
+{
+    // Anything beyond the announced Content-Length would corrupt the connection
+    const QByteArray accepted = chunk.left(m_totalSize - m_received);
+    if (accepted.isEmpty()) {
+        return;
+    }
+    m_chunks.append(accepted);
+    m_received += accepted.size();
+    m_buffered += accepted.size();
+    Q_EMIT readyRead();
+}
+
+qint64 ProxyUploadDevice::totalSize() const
+{
+    return m_totalSize;
+}
+
+qint64 ProxyUploadDevice::receivedBytes() const
+{
+    return m_received;
+}
+
+qint64 ProxyUploadDevice::bufferedBytes() const
+{
+    return m_buffered;
+}
+
+bool ProxyUploadDevice::isSequential() const
+{
+    return true;
+}
+
+bool ProxyUploadDevice::atEnd() const
+{
+    return m_received == m_totalSize && m_buffered == 0 && QIODevice::bytesAvailable() == 0;
+}
+
+qint64 ProxyUploadDevice::bytesAvailable() const
+{
+    return m_buffered + QIODevice::bytesAvailable();
+}
+
+qint64 ProxyUploadDevice::size() const
+{
+    return m_totalSize;
+}
+
+qint64 ProxyUploadDevice::readData(char *data, qint64 maxSize)
+{
+    if (m_buffered == 0) {
+        return m_received == m_totalSize ? -1 : 0;
+    }
+
+    qint64 copied = 0;
+    while (copied < maxSize && !m_chunks.isEmpty()) {
+        const QByteArray &head = m_chunks.constFirst();
+        const qint64 take = qMin<qint64>(maxSize - copied, head.size() - m_headOffset);
+        std::memcpy(data + copied, head.constData() + m_headOffset, take);
+        copied += take;
+        m_headOffset += take;
+        if (m_headOffset == head.size()) {
+            m_chunks.removeFirst();
+            m_headOffset = 0;
+        }
+    }
+    m_buffered -= copied;
+    return copied;
+}
+
+qint64 ProxyUploadDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2025 Denys Madureira
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PROXYUPLOADDEVICE_H
+#define PROXYUPLOADDEVICE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+
+// Sequential request body fed chunk by chunk from the page (TlsProxyBridge::appendUploadChunk)
+// while QNetworkAccessManager streams it to the sidecar. Only the chunks not yet
+// sent are held in memory; reads return 0 until more data arrives, and the device
+// reaches its end once the announced size has been received and consumed.
+class ProxyUploadDevice : public QIODevice
+{
+public:
+    explicit ProxyUploadDevice(qint64 totalSize, QObject *parent = nullptr);
+
+    void append(const QByteArray &chunk);
+
+    qint64 totalSize() const;
+    qint64 receivedBytes() const;
+    qint64 bufferedBytes() const;
+
+    bool isSequential() const override;
+    bool atEnd() const override;
+    qint64 bytesAvailable() const override;
+    qint64 size() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QList<QByteArray> m_chunks;
+    qint64 m_headOffset = 0;
+    qint64 m_totalSize;
+    qint64 m_received = 0;
+    qint64 m_buffered = 0;
+};
+
+#endif // PROXYUPLOADDEVICE_H
@@ -2,8 +2,11 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "tlsproxybridge.h"
+#include "proxytelemetry.h"
+#include "proxyuploaddevice.h"
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
@@ -12,14 +15,40 @@
 #include <QStandardPaths>
 #include <QUuid>
 
+#include <memory>
+
 namespace
 {
 constexpr int REQUEST_TIMEOUT_MS = 45000;
+constexpr qint64 UPLOAD_PROGRESS_STEP = 256 * 1024;
+
+// Content codings the shim can hand to the page's DecompressionStream
+QByteArray passthroughEncodings(const QString &acceptEncoding)
+{
+    static const QList<QByteArray> known{"gzip", "deflate", "br", "zstd"};
+    QList<QByteArray> accepted;
+    const QList<QByteArray> requested = acceptEncoding.toLatin1().split(',');
+    for (const QByteArray &entry : requested) {
+        const QByteArray coding = entry.trimmed().toLower();
+        if (known.contains(coding) && !accepted.contains(coding)) {
+            accepted.append(coding);
+        }
+    }
+    return accepted.join(", ");
+}
+
+// Milestones of one proxied request, in microseconds since it was issued
+struct RequestTiming {
+    QElapsedTimer clock;
+    qint64 sentMicros = -1;
+    qint64 headersMicros = -1;
+};
 }
 
 TlsProxyBridge::TlsProxyBridge(QObject *parent)
     : QObject(parent)
     , m_networkManager(new QNetworkAccessManager(this))
+    , m_telemetry(new ProxyTelemetry(this))
     , m_token(QUuid::createUuid().toString(QUuid::WithoutBraces))
 {
     startSidecar();
@@ -33,6 +62,16 @@ TlsProxyBridge::~TlsProxyBridge()
     }
 }
 
+TlsProxyProfileBridge *TlsProxyBridge::forProfile(const QString &storageName)
+{
+    TlsProxyProfileBridge *&endpoint = m_profileBridges[storageName];
+    if (!endpoint) {
+        // Parented to this bridge, so QML never garbage-collects it
+        endpoint = new TlsProxyProfileBridge(this, storageName, QStringLiteral("%1:").arg(m_profileBridges.size()));
+    }
+    return endpoint;
+}
+
 bool TlsProxyBridge::proxyReady() const
 {
     return m_ready;
@@ -73,6 +112,21 @@ void TlsProxyBridge::learnHost(const QString &host)
     Q_EMIT learnedHostsChanged();
 }
 
+bool TlsProxyBridge::preserveCompression() const
+{
+    return m_preserveCompression;
+}
+
+void TlsProxyBridge::setPreserveCompression(bool enabled)
+{
+    m_preserveCompression = enabled;
+}
+
+ProxyTelemetry *TlsProxyBridge::telemetry() const
+{
+    return m_telemetry;
+}
+
 void TlsProxyBridge::setProxyBaseUrlForTesting(const QUrl &baseUrl)
 {
     m_baseUrl = baseUrl;
@@ -159,43 +213,150 @@ void TlsProxyBridge::startSidecar()
     m_process->start();
 }
 
-void TlsProxyBridge::fetchViaProxy(const QString &requestId, const QJsonObject &request)
+bool TlsProxyBridge::prepareRequest(const QString &requestId, const QJsonObject &request, const QString &profile, QNetworkRequest &networkRequest)
 {
     if (!m_ready) {
         Q_EMIT fetchResponse(requestId, {{QStringLiteral("error"), QStringLiteral("proxy-unavailable")}});
-        return;
+        return false;
     }
 
     const QString targetUrl = request.value(QStringLiteral("url")).toString();
     const QString method = request.value(QStringLiteral("method")).toString().toUpper();
     if (!targetUrl.startsWith(QStringLiteral("https://")) || method.isEmpty()) {
         Q_EMIT fetchResponse(requestId, {{QStringLiteral("error"), QStringLiteral("invalid-request")}});
-        return;
+        return false;
     }
 
-    QNetworkRequest networkRequest(m_baseUrl);
+    networkRequest.setUrl(m_baseUrl);
     networkRequest.setRawHeader("X-Unify-Token", m_token.toUtf8());
     networkRequest.setRawHeader("X-Unify-Target-Url", targetUrl.toUtf8());
+    // Never taken from the request: the page chooses what goes in there
+    if (!profile.isEmpty()) {
+        networkRequest.setRawHeader("X-Unify-Profile", profile.toUtf8());
+    }
     networkRequest.setTransferTimeout(REQUEST_TIMEOUT_MS);
+    // An explicit value also stops QNetworkAccessManager from decoding the reply,
+    // so compressed passthrough bodies reach the page byte for byte
+    networkRequest.setRawHeader("Accept-Encoding", "identity");
+    if (m_preserveCompression) {
+        const QByteArray encodings = passthroughEncodings(request.value(QStringLiteral("acceptEncoding")).toString());
+        if (!encodings.isEmpty()) {
+            networkRequest.setRawHeader("X-Unify-Accept-Encoding", encodings);
+        }
+    }
 
     const QJsonObject headers = request.value(QStringLiteral("headers")).toObject();
     for (auto it = headers.begin(); it != headers.end(); ++it) {
         const QByteArray name = it.key().toUtf8();
         const QByteArray lowered = name.toLower();
-        if (lowered == "host" || lowered == "content-length" || lowered == "connection") {
+        if (lowered == "host" || lowered == "content-length" || lowered == "connection" || lowered == "accept-encoding") {
             continue;
         }
         networkRequest.setRawHeader(name, it.value().toString().toUtf8());
     }
+    return true;
+}
+
+void TlsProxyBridge::fetchViaProxy(const QString &requestId, const QJsonObject &request, const QString &profile)
+{
+    QNetworkRequest networkRequest;
+    if (!prepareRequest(requestId, request, profile, networkRequest)) {
+        return;
+    }
 
+    const QByteArray method = request.value(QStringLiteral("method")).toString().toUpper().toUtf8();
     const QByteArray body = QByteArray::fromBase64(request.value(QStringLiteral("bodyBase64")).toString().toUtf8());
-    QNetworkReply *reply = m_networkManager->sendCustomRequest(networkRequest, method.toUtf8(), body);
+    QNetworkReply *reply = m_networkManager->sendCustomRequest(networkRequest, method, body);
+    watchReply(reply, requestId, request, body.size());
+}
+
+void TlsProxyBridge::beginUpload(const QString &requestId, const QJsonObject &request, const QString &profile)
+{
+    QNetworkRequest networkRequest;
+    if (!prepareRequest(requestId, request, profile, networkRequest)) {
+        return;
+    }
 
+    const qint64 bodySize = request.value(QStringLiteral("bodySize")).toInteger(-1);
+    if (bodySize < 0 || m_uploads.contains(requestId)) {
+        Q_EMIT fetchResponse(requestId, {{QStringLiteral("error"), QStringLiteral("invalid-request")}});
+        return;
+    }
+
+    // Known length + no buffering lets QNetworkAccessManager send chunks as the page delivers them
+    auto *device = new ProxyUploadDevice(bodySize, this);
+    device->open(QIODevice::ReadOnly);
+    networkRequest.setHeader(QNetworkRequest::ContentLengthHeader, bodySize);
+    networkRequest.setAttribute(QNetworkRequest::DoNotBufferUploadDataAttribute, true);
+
+    const QByteArray method = request.value(QStringLiteral("method")).toString().toUpper().toUtf8();
+    QNetworkReply *reply = m_networkManager->sendCustomRequest(networkRequest, method, device);
+    device->setParent(reply);
+    m_uploads.insert(requestId, device);
+
+    // Throttled: every progress signal is broadcast to all pages on the channel
+    auto lastReported = std::make_shared<qint64>(0);
+    connect(reply, &QNetworkReply::uploadProgress, this, [this, requestId, lastReported](qint64 sent, qint64 total) {
+        if (sent - *lastReported < UPLOAD_PROGRESS_STEP && sent != total) {
+            return;
+        }
+        *lastReported = sent;
+        Q_EMIT uploadProgress(requestId, sent, total);
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, requestId]() {
+        m_uploads.remove(requestId);
+    });
+    watchReply(reply, requestId, request, bodySize);
+}
+
+qint64 TlsProxyBridge::appendUploadChunk(const QString &requestId, const QString &chunkBase64)
+{
+    ProxyUploadDevice *device = m_uploads.value(requestId);
+    if (!device) {
+        return -1;
+    }
+    device->append(QByteArray::fromBase64(chunkBase64.toLatin1()));
+    return device->bufferedBytes();
+}
+
+void TlsProxyBridge::cancelUpload(const QString &requestId)
+{
+    ProxyUploadDevice *device = m_uploads.value(requestId);
+    if (auto *reply = device ? qobject_cast<QNetworkReply *>(device->parent()) : nullptr) {
+        reply->abort();
+    }
+}
+
+void TlsProxyBridge::watchReply(QNetworkReply *reply, const QString &requestId, const QJsonObject &request, qint64 bytesOut)
+{
+    const QString host = QUrl(request.value(QStringLiteral("url")).toString()).host();
     // Generic-fallback retries that succeed reveal hosts gated by TLS fingerprint
-    const QString retryHost = request.value(QStringLiteral("isRetry")).toBool() ? QUrl(targetUrl).host() : QString();
+    const QString retryHost = request.value(QStringLiteral("isRetry")).toBool() ? host : QString();
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, requestId, retryHost]() {
+    // Queue phase: until the request has left for the sidecar (QNetworkAccessManager
+    // runs a handful of connections per host); sidecar phase: from there to the
+    // response headers, minus the upstream time the sidecar reports
+    auto timing = std::make_shared<RequestTiming>();
+    timing->clock.start();
+    connect(reply, &QNetworkReply::requestSent, this, [timing]() {
+        if (timing->sentMicros < 0) {
+            timing->sentMicros = timing->clock.nsecsElapsed() / 1000;
+        }
+    });
+    connect(reply, &QNetworkReply::metaDataChanged, this, [timing]() {
+        if (timing->headersMicros < 0) {
+            timing->headersMicros = timing->clock.nsecsElapsed() / 1000;
+        }
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, requestId, host, retryHost, bytesOut, timing]() {
         reply->deleteLater();
+        ProxyTelemetry::Sample sample;
+        sample.host = host;
+        sample.bytesOut = bytesOut;
+        sample.totalMicros = timing->clock.nsecsElapsed() / 1000;
+        sample.queueMicros = timing->sentMicros;
+
         QJsonObject response;
         const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
         if (status > 0) {
@@ -205,13 +366,85 @@ void TlsProxyBridge::fetchViaProxy(const QString &requestId, const QJsonObject &
             QJsonObject responseHeaders;
             const QList<QNetworkReply::RawHeaderPair> rawPairs = reply->rawHeaderPairs();
             for (const auto &pair : rawPairs) {
-                responseHeaders.insert(QString::fromUtf8(pair.first).toLower(), QString::fromUtf8(pair.second));
+                const QString name = QString::fromUtf8(pair.first).toLower();
+                if (!name.startsWith(QStringLiteral("x-unify-"))) {
+                    responseHeaders.insert(name, QString::fromUtf8(pair.second));
+                }
             }
             response.insert(QStringLiteral("headers"), responseHeaders);
-            response.insert(QStringLiteral("bodyBase64"), QString::fromUtf8(reply->readAll().toBase64()));
+            const QByteArray body = reply->readAll();
+            response.insert(QStringLiteral("bodyBase64"), QString::fromUtf8(body.toBase64()));
+
+            sample.status = status;
+            sample.bytesIn = body.size();
+            bool ok = false;
+            const double upstreamMillis = reply->rawHeader("X-Unify-Upstream-Time").toDouble(&ok);
+            if (ok) {
+                sample.upstreamMicros = qint64(upstreamMillis * 1000);
+            }
+            if (timing->sentMicros >= 0 && timing->headersMicros >= timing->sentMicros) {
+                sample.sidecarMicros = qMax<qint64>(0, timing->headersMicros - timing->sentMicros - qMax<qint64>(0, sample.upstreamMicros));
+            }
         } else {
             response.insert(QStringLiteral("error"), reply->errorString());
         }
+        m_telemetry->record(sample);
         Q_EMIT fetchResponse(requestId, response);
     });
 }
+
+TlsProxyProfileBridge::TlsProxyProfileBridge(TlsProxyBridge *bridge, const QString &profile, const QString &idPrefix)
+    : QObject(bridge)
+    , m_bridge(bridge)
+    , m_profile(profile)
+    , m_idPrefix(idPrefix)
+{
+    // The bridge answers every profile; only this one's requests come through
+    connect(bridge, &TlsProxyBridge::fetchResponse, this, [this](const QString &requestId, const QJsonObject &response) {
+        if (requestId.startsWith(m_idPrefix)) {
+            Q_EMIT fetchResponse(requestId.mid(m_idPrefix.size()), response);
+        }
+    });
+    connect(bridge, &TlsProxyBridge::uploadProgress, this, [this](const QString &requestId, qint64 sent, qint64 total) {
+        if (requestId.startsWith(m_idPrefix)) {
+            Q_EMIT uploadProgress(requestId.mid(m_idPrefix.size()), sent, total);
+        }
+    });
+    connect(bridge, &TlsProxyBridge::proxyReadyChanged, this, &TlsProxyProfileBridge::proxyReadyChanged);
+    connect(bridge, &TlsProxyBridge::proxyHostsChanged, this, &TlsProxyProfileBridge::proxyHostsChanged);
+}
+
+bool TlsProxyProfileBridge::proxyReady() const
+{
+    return m_bridge->proxyReady();
+}
+
+QStringList TlsProxyProfileBridge::proxyHosts() const
+{
+    return m_bridge->proxyHosts();
+}
+
+QString TlsProxyProfileBridge::profile() const
+{
+    return m_profile;
+}
+
+void TlsProxyProfileBridge::fetchViaProxy(const QString &requestId, const QJsonObject &request)
+{
+    m_bridge->fetchViaProxy(m_idPrefix + requestId, request, m_profile);
+}
+
+void TlsProxyProfileBridge::beginUpload(const QString &requestId, const QJsonObject &request)
+{
+    m_bridge->beginUpload(m_idPrefix + requestId, request, m_profile);
+}
+
+qint64 TlsProxyProfileBridge::appendUploadChunk(const QString &requestId, const QString &chunkBase64)
+{
+    return m_bridge->appendUploadChunk(m_idPrefix + requestId, chunkBase64);
+}
+
+void TlsProxyProfileBridge::cancelUpload(const QString &requestId)
+{
+    m_bridge->cancelUpload(m_idPrefix + requestId);
+}
@@ -4,17 +4,59 @@
 #ifndef TLSPROXYBRIDGE_H
 #define TLSPROXYBRIDGE_H
 
+#include <QHash>
 #include <QJsonObject>
 #include <QObject>
+#include <QPointer>
 #include <QUrl>
 
+class ProxyTelemetry;
+class ProxyUploadDevice;
 class QNetworkAccessManager;
 class QNetworkReply;
+class QNetworkRequest;
 class QProcess;
+class TlsProxyBridge;
 
-// Bridge exposed to web pages via QWebChannel. Routes requests through the
-// local cf-proxy.py sidecar, which re-issues them with a real browser TLS
-// fingerprint to bypass Cloudflare's TLS-fingerprint bot detection.
+// What the pages of one WebEngineProfile see of TlsProxyBridge, published as
+// "tlsProxyBridge" on that profile's own web channel. The profile is fixed
+// here instead of coming from the page, so page script can neither use
+// another profile's sidecar session (and its cookies) nor see its responses.
+class TlsProxyProfileBridge : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool proxyReady READ proxyReady NOTIFY proxyReadyChanged)
+    Q_PROPERTY(QStringList proxyHosts READ proxyHosts NOTIFY proxyHostsChanged)
+
+public:
+    // idPrefix keeps this profile's request ids apart from other profiles'
+    TlsProxyProfileBridge(TlsProxyBridge *bridge, const QString &profile, const QString &idPrefix);
+
+    bool proxyReady() const;
+    QStringList proxyHosts() const;
+    QString profile() const;
+
+    // See TlsProxyBridge; any "profile" in the request is ignored
+    Q_INVOKABLE void fetchViaProxy(const QString &requestId, const QJsonObject &request);
+    Q_INVOKABLE void beginUpload(const QString &requestId, const QJsonObject &request);
+    Q_INVOKABLE qint64 appendUploadChunk(const QString &requestId, const QString &chunkBase64);
+    Q_INVOKABLE void cancelUpload(const QString &requestId);
+
+Q_SIGNALS:
+    void fetchResponse(const QString &requestId, const QJsonObject &response);
+    void uploadProgress(const QString &requestId, qint64 sent, qint64 total);
+    void proxyReadyChanged();
+    void proxyHostsChanged();
+
+private:
+    TlsProxyBridge *m_bridge;
+    QString m_profile;
+    QString m_idPrefix;
+};
+
+// Routes requests through the local cf-proxy.py sidecar, which re-issues them
+// with a real browser TLS fingerprint to bypass Cloudflare's TLS-fingerprint
+// bot detection. Pages reach it through a TlsProxyProfileBridge (forProfile).
 class TlsProxyBridge : public QObject
 {
     Q_OBJECT
@@ -36,12 +78,39 @@ public:
     QStringList learnedHosts() const;
     Q_INVOKABLE void dismissLearnedHost(const QString &host);
 
-    Q_INVOKABLE void fetchViaProxy(const QString &requestId, const QJsonObject &request);
+    // When set, upstream bodies stay compressed (in the encodings the page can
+    // decode) through the sidecar and the bridge; the shim decompresses them
+    bool preserveCompression() const;
+    void setPreserveCompression(bool enabled);
+
+    // Per-host request counts, status classes, bytes and latency histograms.
+    // Deliberately not a property: the telemetry model is for QML and D-Bus
+    // only, never for pages.
+    ProxyTelemetry *telemetry() const;
+
+    // The endpoint for pages of the WebEngineProfile with this storage name,
+    // created on first use and owned by this bridge
+    Q_INVOKABLE TlsProxyProfileBridge *forProfile(const QString &storageName);
+
+    // profile: storage name of the WebEngineProfile the request comes from; the
+    // sidecar keeps one cookie jar and connection pool per profile, and an
+    // empty name uses its default session
+    void fetchViaProxy(const QString &requestId, const QJsonObject &request, const QString &profile = QString());
+
+    // Streamed upload: same request as fetchViaProxy but with "bodySize" instead of
+    // "bodyBase64"; the body follows in appendUploadChunk calls and the response
+    // arrives through fetchResponse. appendUploadChunk returns the bytes still
+    // waiting to be sent (the page pauses above a high-water mark), or -1 once the
+    // request is gone.
+    void beginUpload(const QString &requestId, const QJsonObject &request, const QString &profile = QString());
+    qint64 appendUploadChunk(const QString &requestId, const QString &chunkBase64);
+    void cancelUpload(const QString &requestId);
 
     void setProxyBaseUrlForTesting(const QUrl &baseUrl);
 
 Q_SIGNALS:
     void fetchResponse(const QString &requestId, const QJsonObject &response);
+    void uploadProgress(const QString &requestId, qint64 sent, qint64 total);
     void proxyReadyChanged();
     void proxyHostsChanged();
     void learnedHostsChanged();
@@ -51,14 +120,20 @@ private:
     QString resolveProxyScriptPath() const;
     void setReady(bool ready);
     void learnHost(const QString &host);
+    bool prepareRequest(const QString &requestId, const QJsonObject &request, const QString &profile, QNetworkRequest &networkRequest);
+    void watchReply(QNetworkReply *reply, const QString &requestId, const QJsonObject &request, qint64 bytesOut);
 
     QNetworkAccessManager *m_networkManager;
+    ProxyTelemetry *m_telemetry;
     QProcess *m_process = nullptr;
     QString m_token;
     QUrl m_baseUrl;
     QStringList m_proxyHosts;
     QStringList m_learnedHosts;
+    QHash<QString, QPointer<ProxyUploadDevice>> m_uploads;
+    QHash<QString, TlsProxyProfileBridge *> m_profileBridges; // by storage name
     bool m_ready = false;
+    bool m_preserveCompression = false;
 };
 
 #endif // TLSPROXYBRIDGE_H
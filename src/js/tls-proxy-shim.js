@@ -37,12 +37,20 @@
     // Seed until the bridge provides the configured list (ConfigManager.tlsProxyHosts)
     var proxyHosts = ["api.standardnotes.com"];
 
+    // Bodies above the threshold are sent as a stream of chunks (beginUpload /
+    // appendUploadChunk) instead of one base64 string, so only a chunk or two is
+    // held at a time; sending pauses while the bridge has HIGH_WATER bytes unsent.
+    var STREAM_UPLOAD_THRESHOLD = 1024 * 1024;
+    var UPLOAD_CHUNK_SIZE = 256 * 1024;
+    var UPLOAD_HIGH_WATER = 1024 * 1024;
+
     var channelPromise = null;
     var channelBridge = null;
     var pending = {};
+    var uploads = {};
     var nextId = 1;
-    // Unique per page: all pages share one bridge, and fetchResponse is broadcast
-    // to every page, so ids must not collide across pages
+    // Unique per page: the pages of a profile share its bridge, and fetchResponse
+    // is broadcast to each of them, so ids must not collide across pages
     var pageId = Math.random().toString(36).slice(2) + Date.now().toString(36);
 
     function getTransport() {
@@ -71,11 +79,13 @@
                     }
                     channelBridge = bridge;
                     bridge.fetchResponse.connect(function (id, response) {
+                        endUpload(id);
                         var settle = pending[id];
                         if (!settle) return;
                         delete pending[id];
                         settle(response);
                     });
+                    bridge.uploadProgress.connect(onUploadProgress);
                     syncHosts(bridge.proxyHosts);
                     bridge.proxyHostsChanged.connect(syncHosts);
                     console.log("[Unify] TLS proxy bridge connected");
@@ -99,6 +109,31 @@
         console.warn("[Unify] TLS proxy hosts:", proxyHosts.join(", ") || "(none)");
     }
 
+    // Content codings this renderer decodes natively (HTTP name -> DecompressionStream
+    // format). Offered upstream so compressed bodies cross the sidecar and the bridge
+    // as-is and are only inflated here, inside Chromium.
+    var decodableEncodings = (function () {
+        var formats = { gzip: "gzip", deflate: "deflate", br: "brotli", zstd: "zstd" };
+        var supported = {};
+        if (typeof DecompressionStream === "undefined") return supported;
+        Object.keys(formats).forEach(function (encoding) {
+            try {
+                new DecompressionStream(formats[encoding]);
+                supported[encoding] = formats[encoding];
+            } catch (e) {}
+        });
+        return supported;
+    })();
+
+    function decodeBody(bytes, headers) {
+        var encoding = String(headers["content-encoding"] || "").trim().toLowerCase();
+        var format = decodableEncodings[encoding];
+        if (!bytes || !bytes.length || !format) return bytes;
+        delete headers["content-encoding"];
+        delete headers["content-length"];
+        return new Blob([bytes]).stream().pipeThrough(new DecompressionStream(format));
+    }
+
     function bytesToBase64(bytes) {
         var binary = "";
         var chunkSize = 0x8000;
@@ -117,25 +152,93 @@
         return bytes;
     }
 
-    function bodyToBase64(body) {
-        if (body === undefined || body === null) return Promise.resolve("");
-        if (typeof body === "string") return Promise.resolve(bytesToBase64(new TextEncoder().encode(body)));
-        if (body instanceof URLSearchParams) return Promise.resolve(bytesToBase64(new TextEncoder().encode(body.toString())));
-        if (body instanceof ArrayBuffer) return Promise.resolve(bytesToBase64(new Uint8Array(body)));
-        if (ArrayBuffer.isView(body)) return Promise.resolve(bytesToBase64(new Uint8Array(body.buffer, body.byteOffset, body.byteLength)));
-        if (typeof Blob !== "undefined" && body instanceof Blob) {
-            return body.arrayBuffer().then(function (buffer) {
-                return bytesToBase64(new Uint8Array(buffer));
+    // Resolves to null, a Uint8Array or a Blob; Blobs are only read later, in chunks if large
+    function bodySource(body) {
+        if (body === undefined || body === null) return Promise.resolve(null);
+        if (typeof body === "string") return Promise.resolve(new TextEncoder().encode(body));
+        if (body instanceof URLSearchParams) return Promise.resolve(new TextEncoder().encode(body.toString()));
+        if (body instanceof ArrayBuffer) return Promise.resolve(new Uint8Array(body));
+        if (ArrayBuffer.isView(body)) return Promise.resolve(new Uint8Array(body.buffer, body.byteOffset, body.byteLength));
+        if (typeof Blob !== "undefined" && body instanceof Blob) return Promise.resolve(body);
+        return Promise.reject(new Error("unsupported-body"));
+    }
+
+    function sourceSize(source) {
+        if (!source) return 0;
+        return source instanceof Uint8Array ? source.length : source.size;
+    }
+
+    function readSource(source, start, end) {
+        if (source instanceof Uint8Array) return Promise.resolve(source.subarray(start, end));
+        return source
+            .slice(start, end)
+            .arrayBuffer()
+            .then(function (buffer) {
+                return new Uint8Array(buffer);
+            });
+    }
+
+    function onUploadProgress(id, sent, total) {
+        var upload = uploads[id];
+        if (!upload) return;
+        upload.sent = sent;
+        // fetch() has no upload progress API; pages or tooling can listen for this instead
+        window.dispatchEvent(new CustomEvent("unify-proxy-upload-progress", { detail: { url: upload.url, loaded: sent, total: total } }));
+        var wake = upload.wake;
+        upload.wake = null;
+        if (wake) wake();
+    }
+
+    function endUpload(id) {
+        var upload = uploads[id];
+        if (!upload) return;
+        delete uploads[id];
+        if (upload.wake) upload.wake();
+    }
+
+    function streamUpload(id, request, source, size) {
+        var upload = { url: request.url, sent: 0, wake: null };
+        var offset = 0;
+        uploads[id] = upload;
+        channelBridge.beginUpload(id, request);
+
+        function waitForDrain(buffered) {
+            if (buffered < UPLOAD_HIGH_WATER || uploads[id] !== upload) return Promise.resolve();
+            return new Promise(function (resolve) {
+                upload.wake = resolve;
+            }).then(function () {
+                return waitForDrain(offset - upload.sent);
             });
         }
-        return Promise.reject(new Error("unsupported-body"));
+
+        function sendNext() {
+            if (offset >= size || uploads[id] !== upload) return Promise.resolve();
+            var end = Math.min(offset + UPLOAD_CHUNK_SIZE, size);
+            return readSource(source, offset, end)
+                .then(function (bytes) {
+                    offset = end;
+                    return new Promise(function (resolve) {
+                        channelBridge.appendUploadChunk(id, bytesToBase64(bytes), resolve);
+                    });
+                })
+                .then(function (buffered) {
+                    // -1: the bridge already answered (error or early response)
+                    if (buffered < 0) return;
+                    return waitForDrain(buffered).then(sendNext);
+                });
+        }
+
+        sendNext().catch(function (error) {
+            console.warn("[Unify] TLS proxy upload aborted:", error && error.message);
+            channelBridge.cancelUpload(id);
+        });
     }
 
     function normalizeRequest(input, init) {
         var url = "";
         var method = "GET";
         var headers = {};
-        var bodyPromise = Promise.resolve("");
+        var bodyPromise = Promise.resolve(null);
 
         function collectHeaders(source) {
             new Headers(source).forEach(function (value, key) {
@@ -150,15 +253,13 @@
             method = input.method || method;
             if (input.headers) collectHeaders(input.headers);
             if (method !== "GET" && method !== "HEAD" && input.body !== null) {
-                bodyPromise = input.arrayBuffer().then(function (buffer) {
-                    return bytesToBase64(new Uint8Array(buffer));
-                });
+                bodyPromise = input.blob();
             }
         }
         if (init) {
             if (init.method) method = init.method;
             if (init.headers) collectHeaders(init.headers);
-            if (init.body !== undefined) bodyPromise = bodyToBase64(init.body);
+            if (init.body !== undefined) bodyPromise = bodySource(init.body);
         }
 
         return { url: url, method: method.toUpperCase(), headers: headers, bodyPromise: bodyPromise };
@@ -169,28 +270,47 @@
         return Promise.all([spec.bodyPromise, ensureChannel()]).then(function (results) {
             if (!results[1]) return Promise.reject(new TypeError("Failed to fetch"));
             var id = pageId + "-" + String(nextId++);
+            var source = results[0];
+            var size = sourceSize(source);
+            var streamed = size > STREAM_UPLOAD_THRESHOLD;
             var request = {
                 url: spec.url,
                 method: spec.method,
                 headers: spec.headers,
-                bodyBase64: results[0],
+                acceptEncoding: Object.keys(decodableEncodings).join(", "),
                 isRetry: isRetry === true
             };
-            return new Promise(function (resolve, reject) {
-                pending[id] = function (response) {
-                    if (!response || response.error) {
-                        reject(new TypeError("Failed to fetch"));
-                        return;
-                    }
-                    var status = response.status || 0;
-                    var body = status === 204 || status === 304 ? null : base64ToBytes(response.bodyBase64 || "");
-                    try {
-                        resolve(new Response(body, { status: status, headers: response.headers || {} }));
-                    } catch (e) {
-                        reject(new TypeError("Failed to fetch"));
+            var ready = Promise.resolve();
+            if (streamed) {
+                request.bodySize = size;
+            } else if (size > 0) {
+                ready = readSource(source, 0, size).then(function (bytes) {
+                    request.bodyBase64 = bytesToBase64(bytes);
+                });
+            }
+            return ready.then(function () {
+                return new Promise(function (resolve, reject) {
+                    pending[id] = function (response) {
+                        if (!response || response.error) {
+                            reject(new TypeError("Failed to fetch"));
+                            return;
+                        }
+                        var status = response.status || 0;
+                        var headers = response.headers || {};
+                        var body = status === 204 || status === 304 ? null : base64ToBytes(response.bodyBase64 || "");
+                        try {
+                            body = decodeBody(body, headers);
+                            resolve(new Response(body, { status: status, headers: headers }));
+                        } catch (e) {
+                            reject(new TypeError("Failed to fetch"));
+                        }
+                    };
+                    if (streamed) {
+                        streamUpload(id, request, source, size);
+                    } else {
+                        channelBridge.fetchViaProxy(id, request);
                     }
-                };
-                channelBridge.fetchViaProxy(id, request);
+                });
             });
         });
     }
@@ -1,5 +1,6 @@
 #include "core/configmanager.h"
 #include "core/notificationpresenter.h"
+#include "core/proxytelemetry.h"
 #include "core/tlsproxybridge.h"
 #include "ui/trayiconmanager.h"
 #include "utils/faviconcache.h"
@@ -11,6 +12,7 @@
 #include <KLocalizedContext>
 #include <KLocalizedString>
 #include <QApplication>
+#include <QDBusConnection>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
@@ -25,36 +27,10 @@
 #include <QtQml>
 #include <QtWebEngineQuick>
 
-// Helper function to find installed Widevine library path
-static QString findWidevinePath()
-{
-    const QString homePath = QDir::homePath();
-    const QString widevinePath = homePath + QStringLiteral("/.var/app/io.github.denysmb.unify/plugins/WidevineCdm");
-    QDir widevineDir(widevinePath);
-
-    if (!widevineDir.exists()) {
-        return QString();
-    }
-
-    // Look for version directories (e.g., 4.10.2830.0)
-    const QStringList entries = widevineDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    for (const QString &entry : entries) {
-        // Check if this looks like a version number
-        if (entry.contains(QLatin1Char('.')) && !entry.isEmpty() && entry.at(0).isDigit()) {
-            const QString libPath = widevinePath + QLatin1Char('/') + entry + QStringLiteral("/_platform_specific/linux_x64/libwidevinecdm.so");
-            if (QFile::exists(libPath)) {
-                return libPath;
-            }
-        }
-    }
-
-    return QString();
-}
-
 int main(int argc, char *argv[])
 {
-    // Check if Widevine is installed
-    const QString widevinePath = findWidevinePath();
+    // Check if Widevine is installed, switching to an update downloaded last run
+    const QString widevinePath = WidevineManager::prepareForStartup();
     const bool isInFlatpak = QFile::exists(QStringLiteral("/.flatpak-info")) || !qEnvironmentVariableIsEmpty("FLATPAK_ID");
 
     // Set Chromium command line arguments for better OAuth/Google compatibility
@@ -105,6 +81,21 @@ int main(int argc, char *argv[])
         qDebug() << "QTWEBENGINE_FORCE_USE_GBM=0 (via UNIFY_WEBENGINE_FORCE_USE_GBM=0)";
     }
 
+    // Overrides written by older versions name a version directory, which
+    // updates eventually remove; follow the current one instead
+    const QByteArray widevineFlag = "--widevine-path=";
+    const qsizetype widevineFlagStart = chromiumFlags.indexOf(widevineFlag);
+    if (!widevinePath.isEmpty() && widevineFlagStart >= 0) {
+        const qsizetype valueStart = widevineFlagStart + widevineFlag.size();
+        const qsizetype valueEnd = chromiumFlags.indexOf(' ', valueStart);
+        const qsizetype valueLength = (valueEnd < 0 ? chromiumFlags.size() : valueEnd) - valueStart;
+        const QByteArray configured = chromiumFlags.mid(valueStart, valueLength);
+        const QByteArray widevineDir = widevinePath.left(widevinePath.indexOf(QStringLiteral("/current/"))).toUtf8();
+        if (configured.startsWith(widevineDir + '/') && configured != widevinePath.toUtf8()) {
+            chromiumFlags.replace(valueStart, valueLength, widevinePath.toUtf8());
+        }
+    }
+
     // Add Widevine path if installed and not already present in flags
     if (!widevinePath.isEmpty() && !chromiumFlags.contains("--widevine-path=")) {
         qDebug() << "Found Widevine at:" << widevinePath;
@@ -151,6 +142,33 @@ int main(int argc, char *argv[])
 
     // Create favicon cache instance
     FaviconCache *faviconCache = new FaviconCache(&app);
+    faviconCache->setDiskBudget(qint64(configManager->iconCacheBudgetMiB()) * 1024 * 1024);
+    QObject::connect(configManager, &ConfigManager::iconCacheBudgetMiBChanged, faviconCache, [faviconCache, configManager]() {
+        faviconCache->setDiskBudget(qint64(configManager->iconCacheBudgetMiB()) * 1024 * 1024);
+    });
+
+    // Icons the sidebar is about to show are downloaded before other workspaces'
+    auto updateFaviconPriority = [faviconCache, configManager]() {
+        const QString workspace = configManager->currentWorkspace();
+        QStringList origins;
+        const QVariantList services = configManager->services();
+        for (const QVariant &value : services) {
+            const QVariantMap service = value.toMap();
+            bool shown = service.value(QStringLiteral("workspace")).toString() == workspace;
+            if (workspace == ConfigManager::ALL_SERVICES_WORKSPACE) {
+                shown = true;
+            } else if (workspace == ConfigManager::FAVORITES_WORKSPACE) {
+                shown = service.value(QStringLiteral("favorite")).toBool();
+            }
+            if (shown) {
+                origins << service.value(QStringLiteral("url")).toString() << service.value(QStringLiteral("image")).toString();
+            }
+        }
+        faviconCache->setPriorityOrigins(origins);
+    };
+    updateFaviconPriority();
+    QObject::connect(configManager, &ConfigManager::currentWorkspaceChanged, faviconCache, updateFaviconPriority);
+    QObject::connect(configManager, &ConfigManager::servicesChanged, faviconCache, updateFaviconPriority);
 
     // Create key event filter for double Ctrl detection
     KeyEventFilter *keyEventFilter = new KeyEventFilter(&app);
@@ -158,6 +176,14 @@ int main(int argc, char *argv[])
 
     // Create notification presenter instance
     NotificationPresenter *notificationPresenter = new NotificationPresenter(&app);
+    notificationPresenter->setBurstWindow(qint64(configManager->notificationBurstSeconds()) * 1000);
+    notificationPresenter->setRateLimit(configManager->notificationRateLimit());
+    QObject::connect(configManager, &ConfigManager::notificationBurstSecondsChanged, notificationPresenter, [notificationPresenter, configManager]() {
+        notificationPresenter->setBurstWindow(qint64(configManager->notificationBurstSeconds()) * 1000);
+    });
+    QObject::connect(configManager, &ConfigManager::notificationRateLimitChanged, notificationPresenter, [notificationPresenter, configManager]() {
+        notificationPresenter->setRateLimit(configManager->notificationRateLimit());
+    });
 
     // Create file utils instance
     FileUtils *fileUtils = new FileUtils(&app);
@@ -241,7 +267,7 @@ int main(int argc, char *argv[])
 
     // TLS proxy bridge: routes requests through a local impersonating sidecar for services
     // whose APIs sit behind Cloudflare TLS-fingerprint bot detection (e.g. Standard Notes).
-    // Registered on a QML WebChannel (Main.qml) shared by all WebViews.
+    // Each WebEngineProfile publishes its own forProfile() endpoint on its own WebChannel (QML).
     TlsProxyBridge *tlsProxyBridge = new TlsProxyBridge(&app);
     tlsProxyBridge->setObjectName(QStringLiteral("tlsProxyBridge"));
 
@@ -251,6 +277,20 @@ int main(int argc, char *argv[])
     QObject::connect(configManager, &ConfigManager::tlsProxyHostsChanged, tlsProxyBridge, [tlsProxyBridge, configManager]() {
         tlsProxyBridge->setProxyHosts(configManager->tlsProxyHosts());
     });
+    tlsProxyBridge->setPreserveCompression(configManager->tlsProxyPreserveCompression());
+    QObject::connect(configManager, &ConfigManager::tlsProxyPreserveCompressionChanged, tlsProxyBridge, [tlsProxyBridge, configManager]() {
+        tlsProxyBridge->setPreserveCompression(configManager->tlsProxyPreserveCompression());
+    });
+
+    // Proxy telemetry for scripting, e.g.
+    // qdbus io.github.denysmb.unify /TlsProxy io.github.denysmb.Unify.TlsProxy.statsJson
+    {
+        QDBusConnection bus = QDBusConnection::sessionBus();
+        if (!bus.registerObject(QStringLiteral("/TlsProxy"), tlsProxyBridge->telemetry(), QDBusConnection::ExportScriptableSlots)
+            || !bus.registerService(QStringLiteral("io.github.denysmb.unify"))) {
+            qWarning() << "Failed to export TLS proxy telemetry on D-Bus:" << bus.lastError().message();
+        }
+    }
 
     // Concatenated shim script (qwebchannel.js + fetch shim), injected into each profile's userScripts
     QString tlsProxyShimSource;
@@ -277,6 +317,10 @@ int main(int argc, char *argv[])
 
     QQmlApplicationEngine engine;
 
+    // Decoded favicons/service images shared by all delegates (image://serviceicon/...).
+    // Not "favicon": QtWebEngine registers that one for WebEngineView.icon.
+    faviconCache->registerImageProvider(&engine);
+
     // Register the notification presenter, config manager, tray icon manager, favicon cache, key event filter, application shortcut manager and file utils with
     // QML context
     engine.rootContext()->setContextProperty(QStringLiteral("notificationPresenter"), notificationPresenter);
@@ -289,6 +333,7 @@ int main(int argc, char *argv[])
     engine.rootContext()->setContextProperty(QStringLiteral("widevineManager"), widevineManager);
     engine.rootContext()->setContextProperty(QStringLiteral("chromeUserAgentGlobal"), chromeUserAgent);
     engine.rootContext()->setContextProperty(QStringLiteral("tlsProxyBridge"), tlsProxyBridge);
+    engine.rootContext()->setContextProperty(QStringLiteral("tlsProxyTelemetry"), tlsProxyBridge->telemetry());
     engine.rootContext()->setContextProperty(QStringLiteral("tlsProxyShimSource"), tlsProxyShimSource);
 
     engine.rootContext()->setContextObject(new KLocalizedContext(&engine));
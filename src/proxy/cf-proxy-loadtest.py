@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2025 Denys Madureira
+# SPDX-License-Identifier: GPL-3.0-or-later
+#
+# Load test for cf-proxy.py. Starts a local HTTPS stub with a throwaway
+# self-signed certificate, launches the sidecar against it and drives
+# concurrent keep-alive clients through the sidecar, the same way
+# TlsProxyBridge does. Reports throughput and latency percentiles.
+# Needs python3, curl_cffi and the openssl CLI; never touches the network.
+#
+#   python3 src/proxy/cf-proxy-loadtest.py --requests 5000 --concurrency 64
+
+import argparse
+import asyncio
+import gzip
+import os
+import ssl
+import subprocess
+import sys
+import tempfile
+import time
+import uuid
+
+SIDECAR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "cf-proxy.py")
+
+
+def make_certificate(directory):
+    cert = os.path.join(directory, "cert.pem")
+    key = os.path.join(directory, "key.pem")
+    subprocess.run(
+        ["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1",
+         "-subj", "/CN=127.0.0.1", "-keyout", key, "-out", cert],
+        check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+    )
+    return cert, key
+
+
+async def read_head(reader):
+    head = await reader.readuntil(b"\r\n\r\n")
+    lines = head.decode("latin-1").split("\r\n")
+    headers = {}
+    for line in lines[1:]:
+        name, sep, value = line.partition(":")
+        if sep:
+            headers[name.strip().lower()] = value.strip()
+    return lines[0], headers
+
+
+async def read_body(reader, headers):
+    if headers.get("transfer-encoding", "").lower() == "chunked":
+        body = bytearray()
+        while True:
+            size = int((await reader.readline()).split(b";")[0], 16)
+            if size == 0:
+                await reader.readline()
+                return bytes(body)
+            body += await reader.readexactly(size)
+            await reader.readline()
+    length = int(headers.get("content-length", "0"))
+    return await reader.readexactly(length) if length else b""
+
+
+async def stub_connection(reader, writer, payload, compressed):
+    try:
+        while True:
+            _, headers = await read_head(reader)
+            await read_body(reader, headers)
+            writer.write(b"HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n")
+            if compressed and "gzip" in headers.get("accept-encoding", ""):
+                writer.write(b"Content-Encoding: gzip\r\nContent-Length: %d\r\n\r\n" % len(compressed))
+                writer.write(compressed)
+            else:
+                writer.write(b"Content-Length: %d\r\n\r\n" % len(payload))
+                writer.write(payload)
+            await writer.drain()
+    except (asyncio.IncompleteReadError, ConnectionError):
+        pass
+    finally:
+        writer.close()
+
+
+async def start_sidecar(env):
+    process = await asyncio.create_subprocess_exec(
+        sys.executable, SIDECAR, env=env, stdout=asyncio.subprocess.PIPE, stderr=asyncio.subprocess.DEVNULL
+    )
+    line = (await asyncio.wait_for(process.stdout.readline(), 10)).decode().strip()
+    if not line.startswith("PORT="):
+        raise RuntimeError("sidecar failed to start: %s" % (line or "no output"))
+    return process, int(line[5:])
+
+
+async def client(port, token, target, profile, options, jobs, latencies, failures, wire_bytes):
+    reader, writer = await asyncio.open_connection("127.0.0.1", port)
+    upload = b"u" * options.upload_size
+    request = (
+        "%s / HTTP/1.1\r\nHost: 127.0.0.1\r\nX-Unify-Token: %s\r\nX-Unify-Target-Url: %s\r\n"
+        "X-Unify-Profile: %s\r\nContent-Length: %d\r\n%s\r\n"
+        % ("POST" if upload else "GET", token, target, profile, len(upload),
+           "X-Unify-Accept-Encoding: gzip\r\n" if options.passthrough else "")
+    ).encode() + upload
+    try:
+        while jobs > 0:
+            jobs -= 1
+            started = time.perf_counter()
+            writer.write(request)
+            status, headers = await read_head(reader)
+            body = await read_body(reader, headers)
+            latencies.append(time.perf_counter() - started)
+            wire_bytes.append(len(body))
+            if headers.get("content-encoding") == "gzip":
+                body = gzip.decompress(body)
+            if " 200 " not in status or len(body) != options.body_size:
+                failures.append(status)
+    finally:
+        writer.close()
+
+
+def peak_rss_kib(pid):
+    try:
+        with open("/proc/%d/status" % pid) as status:
+            for line in status:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1])
+    except OSError:
+        pass
+    return 0
+
+
+def percentile(sorted_values, fraction):
+    if not sorted_values:
+        return 0.0
+    index = min(len(sorted_values) - 1, int(round(fraction * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+async def run(args):
+    with tempfile.TemporaryDirectory() as directory:
+        cert, key = make_certificate(directory)
+        context = ssl.create_default_context(ssl.Purpose.CLIENT_AUTH)
+        context.load_cert_chain(cert, key)
+        if args.compressible:
+            record = b'{"uuid":"%s","content_type":"Note","content":"lorem ipsum dolor sit amet"},'
+            payload = b"".join(record % uuid.uuid4().hex.encode() for _ in range(args.body_size // 80 + 1))[: args.body_size]
+            compressed = gzip.compress(payload)
+        else:
+            payload = os.urandom(args.body_size)
+            compressed = None
+        stub = await asyncio.start_server(
+            lambda r, w: stub_connection(r, w, payload, compressed), "127.0.0.1", 0, ssl=context
+        )
+        stub_port = stub.sockets[0].getsockname()[1]
+
+        token = uuid.uuid4().hex
+        env = dict(os.environ)
+        env["UNIFY_PROXY_TOKEN"] = token
+        env["UNIFY_PROXY_INSECURE_FOR_TESTING"] = "1"
+        env["UNIFY_PROXY_MAX_WORKERS"] = str(args.workers)
+        process, port = await start_sidecar(env)
+
+        target = "https://127.0.0.1:%d/payload" % stub_port
+        latencies = []
+        failures = []
+        wire_bytes = []
+        try:
+            # Warm the upstream connection pool so the numbers reflect steady state
+            profiles = ["loadtest-%d" % (i % args.profiles) for i in range(args.concurrency)]
+            await asyncio.gather(*[client(port, token, target, profile, args, 1, [], [], []) for profile in profiles])
+            share, extra = divmod(args.requests, args.concurrency)
+            started = time.perf_counter()
+            await asyncio.gather(*[
+                client(port, token, target, profiles[i], args, share + (1 if i < extra else 0), latencies, failures, wire_bytes)
+                for i in range(args.concurrency)
+            ])
+            elapsed = time.perf_counter() - started
+            sidecar_rss = peak_rss_kib(process.pid)
+        finally:
+            process.terminate()
+            await process.wait()
+            stub.close()
+
+    latencies.sort()
+    print("requests      %d (%d failed)" % (len(latencies), len(failures)))
+    print("concurrency   %d clients, %d sidecar workers, %d profiles" % (args.concurrency, args.workers, args.profiles))
+    print("body size     %d bytes%s, upload %d bytes" % (args.body_size, " (compressible)" if args.compressible else "", args.upload_size))
+    # What TlsProxyBridge then copies: the loopback body, and its base64 form in the JSON message
+    per_response = sum(wire_bytes) / max(1, len(wire_bytes))
+    print("loopback body %.0f bytes/response%s" % (per_response, " (gzip passthrough)" if args.passthrough else ""))
+    print("bridge base64 %.0f bytes/response" % (4 * ((per_response + 2) // 3)))
+    print("wall time     %.2f s" % elapsed)
+    print("sidecar RSS   %.1f MiB peak" % (sidecar_rss / 1024))
+    print("throughput    %.1f req/s, %.2f MiB/s" % (len(latencies) / elapsed, len(latencies) * args.body_size / elapsed / 1048576))
+    for label, fraction in (("p50", 0.50), ("p95", 0.95), ("p99", 0.99), ("max", 1.0)):
+        print("%-13s %.2f ms" % (label, percentile(latencies, fraction) * 1000))
+    return 1 if failures else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Load test the cf-proxy.py sidecar against a local HTTPS stub")
+    parser.add_argument("--requests", type=int, default=2000)
+    parser.add_argument("--concurrency", type=int, default=64)
+    parser.add_argument("--workers", type=int, default=32, help="UNIFY_PROXY_MAX_WORKERS for the sidecar")
+    parser.add_argument("--profiles", type=int, default=1, help="distinct X-Unify-Profile values spread across clients")
+    parser.add_argument("--body-size", type=int, default=16384)
+    parser.add_argument("--upload-size", type=int, default=0, help="request body bytes sent with each request")
+    parser.add_argument("--compressible", action="store_true", help="serve JSON-like text, gzip-encoded when accepted")
+    parser.add_argument("--passthrough", action="store_true", help="ask the sidecar to relay gzip bodies undecoded")
+    args = parser.parse_args()
+    sys.exit(asyncio.run(run(args)))
+
+
+if __name__ == "__main__":
+    main()
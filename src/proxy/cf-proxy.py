@@ -7,13 +7,24 @@
 # detection rejects (cf-mitigated: challenge on CORS preflights). This sidecar
 # re-issues requests through curl_cffi with a real browser fingerprint.
 # Binds to 127.0.0.1 only and requires a per-session token header.
+#
+# Runs on a single asyncio event loop: client connections are HTTP/1.1
+# keep-alive, upstream requests go through one AsyncSession (HTTP/2, pooled
+# connections) per WebEngineProfile and response bodies are streamed back
+# chunk by chunk.
 
+import asyncio
 import os
+import re
 import sys
-from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+import time
+from collections import OrderedDict
+from contextlib import asynccontextmanager
+from http import HTTPStatus
 
 try:
-    from curl_cffi import requests as curl_requests
+    from curl_cffi import CurlHttpVersion
+    from curl_cffi.requests import AsyncSession
 except ImportError:
     print("ERROR=curl_cffi-missing", flush=True)
     sys.exit(1)
@@ -21,11 +32,29 @@ except ImportError:
 TOKEN = os.environ.get("UNIFY_PROXY_TOKEN", "")
 IMPERSONATE = os.environ.get("UNIFY_PROXY_IMPERSONATE", "chrome99")
 
-# Single session = single cookie jar. Cookie-based login flows (e.g. Standard
-# Notes uses access-control-allow-credentials) depend on cookies being stored
-# and resent; the browser's own cookie jar is bypassed on this code path.
-# TODO(tls-proxy): per-profile cookie jars for multi-account isolated profiles
-SESSION = curl_requests.Session(impersonate=IMPERSONATE)
+# Upper bound on upstream requests in flight; further requests wait their turn
+MAX_WORKERS = max(1, int(os.environ.get("UNIFY_PROXY_MAX_WORKERS", "32")))
+
+# Upper bound on live per-profile sessions; the least recently used one is
+# closed (dropping its cookies) when another profile needs a slot
+MAX_PROFILES = max(1, int(os.environ.get("UNIFY_PROXY_MAX_PROFILES", "16")))
+
+# Only set by cf-proxy-loadtest.py, whose HTTPS stub uses a self-signed certificate
+VERIFY_TLS = os.environ.get("UNIFY_PROXY_INSECURE_FOR_TESTING") != "1"
+
+UPSTREAM_TIMEOUT = 30
+MAX_HEADER_BYTES = 64 * 1024
+
+# Larger request bodies are relayed upstream as they arrive instead of being
+# read whole first (TlsProxyBridge streams big uploads from the page)
+STREAM_UPLOAD_THRESHOLD = 256 * 1024
+UPLOAD_CHUNK_SIZE = 64 * 1024
+
+ALLOWED_METHODS = {"GET", "POST", "PUT", "PATCH", "DELETE", "OPTIONS", "HEAD"}
+
+# WebEngineProfile storage names ("unify-storage", "unify-isolated-<id>", ...)
+PROFILE_PATTERN = re.compile(r"[A-Za-z0-9_-]{1,128}")
+DEFAULT_PROFILE = "default"
 
 HOP_BY_HOP = {
     "connection",
@@ -38,79 +67,312 @@ HOP_BY_HOP = {
     "proxy-authorization",
     "content-length",
     "content-encoding",
+    "accept-encoding",
     "host",
 }
 
 
-class ProxyHandler(BaseHTTPRequestHandler):
-    protocol_version = "HTTP/1.1"
+class BadRequest(Exception):
+    pass
+
+
+class BodyStream:
+    # Async iterable request body for curl_cffi, read from the client socket on demand
+
+    def __init__(self, reader, length):
+        self.reader = reader
+        self.length = length
+        self.remaining = length
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self):
+        if self.remaining <= 0:
+            raise StopAsyncIteration
+        chunk = await self.reader.read(min(UPLOAD_CHUNK_SIZE, self.remaining))
+        if not chunk:
+            raise ConnectionError("client closed the connection mid-upload")
+        self.remaining -= len(chunk)
+        return chunk
+
+
+class Request:
+    def __init__(self, method, version, headers):
+        self.method = method
+        self.version = version
+        self.headers = headers
+        self._lookup = {key.lower(): value for key, value in headers}
+
+    def header(self, name, default=""):
+        return self._lookup.get(name, default)
+
+    def wants_keep_alive(self):
+        connection = self.header("connection").lower()
+        if self.version == "HTTP/1.0":
+            return connection == "keep-alive"
+        return connection != "close"
+
+
+def parse_request_head(head):
+    lines = head.decode("latin-1").split("\r\n")
+    parts = lines[0].split(" ")
+    if len(parts) != 3 or not parts[2].startswith("HTTP/1."):
+        raise BadRequest("malformed request line")
+    headers = []
+    for line in lines[1:]:
+        if not line:
+            continue
+        name, sep, value = line.partition(":")
+        if not sep:
+            raise BadRequest("malformed header line")
+        headers.append((name.strip(), value.strip()))
+    return Request(parts[0].upper(), parts[2], headers)
+
+
+def status_line(code):
+    try:
+        reason = HTTPStatus(code).phrase
+    except ValueError:
+        reason = ""
+    return ("HTTP/1.1 %d %s\r\n" % (code, reason)).encode("latin-1")
+
+
+def body_fully_read(body):
+    return not isinstance(body, BodyStream) or body.remaining == 0
+
+
+def has_body(method, code):
+    return method != "HEAD" and code >= 200 and code not in (204, 304)
+
+
+def create_session():
+    # HTTP/2 lets concurrent requests to one host multiplex over a single
+    # pooled connection
+    return AsyncSession(
+        impersonate=IMPERSONATE,
+        http_version=CurlHttpVersion.V2TLS,
+        max_clients=MAX_WORKERS,
+        verify=VERIFY_TLS,
+    )
+
 
-    def log_message(self, fmt, *args):
-        sys.stderr.write("cf-proxy: " + (fmt % args) + "\n")
+class PooledSession:
+    def __init__(self):
+        self.session = create_session()
+        self.users = 0
+        self.evicted = False
 
-    def _respond(self, code, body):
-        payload = body.encode("utf-8") if isinstance(body, str) else body
-        self.send_response(code)
-        self.send_header("Content-Type", "text/plain")
-        self.send_header("Content-Length", str(len(payload)))
-        self.end_headers()
-        if self.command != "HEAD":
-            self.wfile.write(payload)
 
-    def _handle(self):
-        if not TOKEN or self.headers.get("X-Unify-Token") != TOKEN:
-            return self._respond(403, "forbidden")
+class SessionPool:
+    # One session per profile = one cookie jar and one connection pool each.
+    # Cookie-based login flows (e.g. Standard Notes uses
+    # access-control-allow-credentials) depend on cookies being stored and
+    # resent, since the browser's own cookie jar is bypassed on this code path;
+    # isolated workspaces and services must not see each other's cookies.
 
-        target = self.headers.get("X-Unify-Target-Url", "")
+    def __init__(self, capacity):
+        self.capacity = capacity
+        self.entries = OrderedDict()
+
+    @asynccontextmanager
+    async def acquire(self, profile):
+        entry = self.entries.get(profile)
+        if entry is None:
+            entry = PooledSession()
+            self.entries[profile] = entry
+        self.entries.move_to_end(profile)
+        entry.users += 1
+        try:
+            await self.evict()
+            yield entry.session
+        finally:
+            entry.users -= 1
+            if entry.evicted and entry.users == 0:
+                await entry.session.close()
+
+    async def evict(self):
+        while len(self.entries) > self.capacity:
+            _, entry = self.entries.popitem(last=False)
+            entry.evicted = True
+            # Sessions with requests in flight are closed by their last user
+            if entry.users == 0:
+                await entry.session.close()
+
+
+class ProxyServer:
+    def __init__(self):
+        self.sessions = SessionPool(MAX_PROFILES)
+        self.workers = asyncio.Semaphore(MAX_WORKERS)
+
+    def log(self, message):
+        sys.stderr.write("cf-proxy: " + message + "\n")
+
+    async def start(self):
+        server = await asyncio.start_server(self.handle_connection, "127.0.0.1", 0, limit=MAX_HEADER_BYTES)
+        print("PORT=%d" % server.sockets[0].getsockname()[1], flush=True)
+        async with server:
+            await server.serve_forever()
+
+    async def handle_connection(self, reader, writer):
+        try:
+            keep_alive = True
+            while keep_alive:
+                try:
+                    head = await reader.readuntil(b"\r\n\r\n")
+                except (asyncio.IncompleteReadError, ConnectionError):
+                    break
+                except asyncio.LimitOverrunError:
+                    await self.respond(writer, "GET", 431, "request header too large", False)
+                    break
+                try:
+                    request = parse_request_head(head)
+                except BadRequest as exc:
+                    await self.respond(writer, "GET", 400, str(exc), False)
+                    break
+                keep_alive = await self.handle_request(request, reader, writer)
+        except ConnectionError:
+            pass
+        except Exception as exc:
+            self.log("connection error: %r" % exc)
+        finally:
+            writer.close()
+
+    async def respond(self, writer, method, code, body, keep_alive):
+        payload = body.encode("utf-8")
+        writer.write(status_line(code))
+        writer.write(b"Content-Type: text/plain\r\n")
+        writer.write(b"Content-Length: %d\r\n" % len(payload))
+        writer.write(b"Connection: %s\r\n\r\n" % (b"keep-alive" if keep_alive else b"close"))
+        if method != "HEAD":
+            writer.write(payload)
+        await writer.drain()
+        return keep_alive
+
+    async def read_body(self, request, reader):
+        if request.header("transfer-encoding"):
+            raise BadRequest("chunked request bodies are not supported")
+        try:
+            length = int(request.header("content-length") or 0)
+        except ValueError:
+            raise BadRequest("invalid content-length")
+        if length > STREAM_UPLOAD_THRESHOLD:
+            return BodyStream(reader, length)
+        return await reader.readexactly(length) if length > 0 else None
+
+    async def handle_request(self, request, reader, writer):
+        method = request.method
+        if method not in ALLOWED_METHODS:
+            return await self.respond(writer, method, 501, "unsupported method", False)
+
+        # Mismatched tokens close the connection before any body is read
+        if not TOKEN or request.header("x-unify-token") != TOKEN:
+            return await self.respond(writer, method, 403, "forbidden", False)
+
+        target = request.header("x-unify-target-url")
         if not target.startswith("https://"):
-            return self._respond(400, "only https targets are allowed")
+            return await self.respond(writer, method, 400, "only https targets are allowed", False)
 
-        length = int(self.headers.get("Content-Length") or 0)
-        body = self.rfile.read(length) if length > 0 else None
+        try:
+            body = await self.read_body(request, reader)
+        except BadRequest as exc:
+            return await self.respond(writer, method, 400, str(exc), False)
 
+        profile = request.header("x-unify-profile")
+        if not PROFILE_PATTERN.fullmatch(profile):
+            profile = DEFAULT_PROFILE
+
+        keep_alive = request.wants_keep_alive()
         forward_headers = {
             key: value
-            for key, value in self.headers.items()
+            for key, value in request.headers
             if key.lower() not in HOP_BY_HOP and not key.lower().startswith("x-unify-")
         }
+        body_options = {"data": body}
+        if isinstance(body, BodyStream):
+            # Keep the length so upstream sees a sized upload rather than a chunked one
+            forward_headers["Content-Length"] = str(body.length)
+            body_options = {"content": body}
 
-        try:
-            upstream = SESSION.request(
-                self.command,
-                target,
-                headers=forward_headers,
-                data=body,
-                timeout=30,
-                allow_redirects=False,
-            )
-        except Exception as exc:
-            return self._respond(502, "upstream error: %s" % exc)
+        # Codings the page decodes itself (TlsProxyBridge preserveCompression):
+        # curl must neither advertise its own list nor decode the body
+        passthrough = request.header("x-unify-accept-encoding")
+        accept_encoding = "gzip, deflate, br"
+        if passthrough:
+            forward_headers["Accept-Encoding"] = passthrough
+            accept_encoding = None
 
-        sys.stderr.write("cf-proxy: %s %s -> %d\n" % (self.command, target, upstream.status_code))
+        async with self.workers, self.sessions.acquire(profile) as session:
+            started = time.perf_counter()
+            try:
+                upstream = await session.request(
+                    method,
+                    target,
+                    headers=forward_headers,
+                    timeout=UPSTREAM_TIMEOUT,
+                    allow_redirects=False,
+                    accept_encoding=accept_encoding,
+                    stream=True,
+                    **body_options,
+                )
+            except ConnectionError:
+                raise
+            except Exception as exc:
+                return await self.respond(writer, method, 502, "upstream error: %s" % exc, keep_alive and body_fully_read(body))
 
-        payload = upstream.content
-        self.send_response(upstream.status_code)
-        for key, value in upstream.headers.items():
-            if key.lower() not in HOP_BY_HOP:
-                self.send_header(key, value)
-        self.send_header("Content-Length", str(len(payload)))
-        self.end_headers()
-        if self.command != "HEAD":
-            self.wfile.write(payload)
+            # Reported to TlsProxyBridge telemetry; waiting for a worker slot is
+            # left out so the bridge can attribute it to the sidecar
+            upstream_ms = (time.perf_counter() - started) * 1000
 
-    do_GET = _handle
-    do_POST = _handle
-    do_PUT = _handle
-    do_PATCH = _handle
-    do_DELETE = _handle
-    do_OPTIONS = _handle
-    do_HEAD = _handle
+            # Upstream may answer early (e.g. 413) with part of the upload still unread
+            keep_alive = keep_alive and body_fully_read(body)
+
+            try:
+                self.log("%s %s -> %d" % (method, target, upstream.status_code))
+                return await self.stream_response(method, upstream, writer, keep_alive, bool(passthrough), upstream_ms)
+            finally:
+                await upstream.aclose()
+
+    async def stream_response(self, method, upstream, writer, keep_alive, passthrough, upstream_ms):
+        code = upstream.status_code
+        writer.write(status_line(code))
+        writer.write(b"X-Unify-Upstream-Time: %.1f\r\n" % upstream_ms)
+        for key, value in upstream.headers.multi_items():
+            lowered = key.lower()
+            if lowered not in HOP_BY_HOP or (passthrough and lowered == "content-encoding"):
+                writer.write(("%s: %s\r\n" % (key, value)).encode("latin-1", "replace"))
+        writer.write(b"Connection: %s\r\n" % (b"keep-alive" if keep_alive else b"close"))
+
+        if not has_body(method, code):
+            writer.write(b"Content-Length: 0\r\n\r\n")
+            await writer.drain()
+            return keep_alive
+
+        writer.write(b"Transfer-Encoding: chunked\r\n\r\n")
+        try:
+            async for chunk in upstream.aiter_content():
+                if chunk:
+                    writer.write(b"%x\r\n" % len(chunk))
+                    writer.write(chunk)
+                    writer.write(b"\r\n")
+                    await writer.drain()
+        except ConnectionError:
+            raise
+        except Exception as exc:
+            # Headers are already out; dropping the connection is the only way
+            # to tell the bridge the body is incomplete
+            self.log("upstream body error: %s" % exc)
+            return False
+        writer.write(b"0\r\n\r\n")
+        await writer.drain()
+        return keep_alive
 
 
 def main():
-    server = ThreadingHTTPServer(("127.0.0.1", 0), ProxyHandler)
-    print("PORT=%d" % server.server_address[1], flush=True)
-    server.serve_forever()
+    try:
+        asyncio.run(ProxyServer().start())
+    except KeyboardInterrupt:
+        pass
 
 
 if __name__ == "__main__":
@@ -35,6 +35,27 @@ Kirigami.ApplicationWindow {
     })
     property int buttonSize: sidebarSizePresets[configManager ? configManager.sidebarSizePreset : "normal"] || sidebarSizePresets.normal
     property int iconSize: Math.round(buttonSize * 0.75)
+
+    // Every preset's icon size at this screen's pixel ratio, decoded ahead of
+    // time by FaviconCache along with ServiceIconButton's corner radius
+    readonly property var sidebarIconVariants: {
+        var dpr = Screen.devicePixelRatio;
+        var sizes = [];
+        for (var preset in sidebarSizePresets) {
+            sizes.push(Math.round(Math.round(sidebarSizePresets[preset] * 0.75) * dpr));
+        }
+        return {
+            "sizes": sizes,
+            "radius": Math.round(Kirigami.Units.mediumSpacing * dpr)
+        };
+    }
+    onSidebarIconVariantsChanged: updateIconVariants()
+
+    function updateIconVariants() {
+        if (typeof faviconCache !== "undefined" && faviconCache !== null) {
+            faviconCache.setPrescaledVariants(sidebarIconVariants.sizes, sidebarIconVariants.radius);
+        }
+    }
     property int sidebarWidth: buttonSize + Kirigami.Units.smallSpacing * 2
 
     // Current selected service name for the header
@@ -264,48 +285,11 @@ Kirigami.ApplicationWindow {
         return Services.findById(services, id);
     }
 
-    // Function to find serviceId by URL origin
+    // Function to find serviceId by URL origin (indexed in ConfigManager)
     function findServiceIdByOrigin(originUrl) {
-        if (!services || !originUrl)
-            return "";
-        var originStr = originUrl.toString().toLowerCase();
-        // Extract host from origin URL
-        var originHost = "";
-        try {
-            originHost = originUrl.host ? originUrl.host.toLowerCase() : "";
-            if (!originHost) {
-                // Try to extract from string
-                var match = originStr.match(/^https?:\/\/([^\/]+)/);
-                if (match)
-                    originHost = match[1].toLowerCase();
-            }
-        } catch (e) {
-            console.warn("Error extracting host from origin:", e);
-        }
-
-        if (!originHost)
+        if (!configManager || !originUrl)
             return "";
-
-        // Search through all services to find matching URL
-        for (var i = 0; i < services.length; i++) {
-            var service = services[i];
-            if (service && service.url) {
-                var serviceUrl = service.url.toString().toLowerCase();
-                try {
-                    var serviceMatch = serviceUrl.match(/^https?:\/\/([^\/]+)/);
-                    if (serviceMatch) {
-                        var serviceHost = serviceMatch[1].toLowerCase();
-                        // Check if hosts match (including subdomains)
-                        if (serviceHost === originHost || originHost.endsWith("." + serviceHost) || serviceHost.endsWith("." + originHost)) {
-                            return service.id;
-                        }
-                    }
-                } catch (e) {
-                    continue;
-                }
-            }
-        }
-        return "";
+        return configManager.serviceIdForOrigin(originUrl);
     }
 
     // Function to find service index by ID
@@ -528,14 +512,6 @@ Kirigami.ApplicationWindow {
         return list;
     }
 
-    // Shared WebChannel carrying the TLS proxy bridge to every WebView
-    WebChannel {
-        id: unifyWebChannel
-        Component.onCompleted: {
-            registerObjects({ "tlsProxyBridge": tlsProxyBridge });
-        }
-    }
-
     Connections {
         target: tlsProxyBridge
         function onLearnedHostsChanged() {
@@ -589,6 +565,10 @@ Kirigami.ApplicationWindow {
         httpCacheType: WebEngineProfile.DiskHttpCache
         persistentCookiesPolicy: WebEngineProfile.ForcePersistentCookies
 
+        // Carries this profile's TLS proxy endpoint to the views using it;
+        // see TlsProxyProfileBridge
+        readonly property WebChannel tlsProxyChannel: WebChannel {}
+
         onPresentNotification: function (notification) {
             if (notificationPresenter) {
                 // Find the serviceId based on the notification origin
@@ -629,6 +609,9 @@ Kirigami.ApplicationWindow {
         }
 
         Component.onCompleted: {
+            if (tlsProxyBridge) {
+                tlsProxyChannel.registerObjects({ "tlsProxyBridge": tlsProxyBridge.forProfile(storageName) });
+            }
             if (typeof tlsProxyShimSource !== "undefined" && tlsProxyShimSource !== "") {
                 var shim = WebEngine.script();
                 shim.name = "tlsProxyShim";
@@ -1405,7 +1388,6 @@ Kirigami.ApplicationWindow {
                             globalMute: root.globalMute
                             serviceTabs: configManager ? configManager.serviceTabs : ({})
                             webProfile: persistentProfile
-                            sharedWebChannel: unifyWebChannel
                             workspaceIsolatedStorage: configManager ? configManager.workspaceIsolatedStorage : ({})
                             onTitleUpdated: root.updateBadgeFromTitle
                             notificationCountCallback: root.updateBadgeFromContent
@@ -1566,7 +1548,6 @@ Kirigami.ApplicationWindow {
                         globalMute: root.globalMute
                         serviceTabs: configManager ? configManager.serviceTabs : ({})
                         webProfile: persistentProfile
-                        sharedWebChannel: unifyWebChannel
                         workspaceIsolatedStorage: configManager ? configManager.workspaceIsolatedStorage : ({})
                         onTitleUpdated: root.updateBadgeFromTitle
                         notificationCountCallback: root.updateBadgeFromContent
@@ -1635,6 +1616,8 @@ Kirigami.ApplicationWindow {
 
     // Initialize with the first workspace on startup - delayed to ensure profile is ready
     Component.onCompleted: {
+        updateIconVariants();
+
         // Initialize disabled states from configManager
         if (configManager) {
             if (configManager.disabledServices) {
@@ -2,7 +2,6 @@ import QtQuick
 import QtQuick.Layouts
 import QtQuick.Window
 import QtQuick.Controls as Controls
-import QtQuick.Effects
 import org.kde.kirigami as Kirigami
 
 Controls.Button {
@@ -89,6 +88,16 @@ Controls.Button {
         }
     }
 
+    // Cached icons come with their rounded corners baked in at this radius
+    // (in device pixels), which keeps the sidebar free of per-icon mask layers
+    function roundedIconUrl(url) {
+        if (!url || !url.startsWith("image://serviceicon/")) {
+            return url;
+        }
+        var radius = Math.round(Kirigami.Units.mediumSpacing * Screen.devicePixelRatio);
+        return url + (url.indexOf("?") < 0 ? "?" : "&") + "r=" + radius;
+    }
+
     function requestCachedAssets() {
         if (typeof faviconCache === "undefined" || faviconCache === null) {
             return;
@@ -263,25 +272,13 @@ Controls.Button {
             Image {
                 id: faviconItem
                 anchors.fill: parent
-                source: root.cachedFaviconUrl
+                source: root.roundedIconUrl(root.cachedFaviconUrl)
                 fillMode: Image.PreserveAspectFit
                 smooth: true
-                mipmap: true
                 cache: true
-                sourceSize: Qt.size(Math.ceil(iconSize * Screen.devicePixelRatio), Math.ceil(iconSize * Screen.devicePixelRatio))
-                visible: false
+                // Scaled by the device pixel ratio in Image itself
+                sourceSize: Qt.size(iconSize, iconSize)
                 asynchronous: true
-            }
-
-            MultiEffect {
-                anchors.fill: faviconItem
-                source: faviconItem
-                maskEnabled: true
-                maskSource: roundedMask
-                maskSpreadAtMin: 1.0
-                maskSpreadAtMax: 1.0
-                maskThresholdMin: 0.5
-                maskThresholdMax: 1.0
                 opacity: root.disabledVisual ? 0.3 : 1.0
             }
         }
@@ -296,25 +293,13 @@ Controls.Button {
             Image {
                 id: imageItem
                 anchors.fill: parent
-                source: root.cachedImageUrl
+                source: root.roundedIconUrl(root.cachedImageUrl)
                 fillMode: Image.PreserveAspectFit
                 smooth: true
-                mipmap: true
                 cache: true
-                sourceSize: Qt.size(Math.ceil(iconSize * Screen.devicePixelRatio), Math.ceil(iconSize * Screen.devicePixelRatio))
-                visible: false
+                // Scaled by the device pixel ratio in Image itself
+                sourceSize: Qt.size(iconSize, iconSize)
                 asynchronous: true
-            }
-
-            MultiEffect {
-                anchors.fill: imageItem
-                source: imageItem
-                maskEnabled: true
-                maskSource: roundedMask
-                maskSpreadAtMin: 1.0
-                maskSpreadAtMax: 1.0
-                maskThresholdMin: 0.5
-                maskThresholdMax: 1.0
                 opacity: root.disabledVisual ? 0.3 : 1.0
             }
         }
@@ -330,19 +315,6 @@ Controls.Button {
             visible: (root.faviconLoading && root.cachedFaviconUrl === "") || (root.imageLoading && root.cachedImageUrl === "")
         }
 
-        Rectangle {
-            id: roundedMask
-            anchors.centerIn: parent
-            width: iconSize
-            height: iconSize
-            radius: Kirigami.Units.mediumSpacing
-            visible: false
-            layer.enabled: true
-            layer.smooth: true
-            layer.samples: 4
-            antialiasing: true
-        }
-
         Kirigami.Icon {
             id: systemIconItem
             anchors.centerIn: parent
@@ -24,8 +24,6 @@ Item {
     property bool globalMute: false
     property var restoredTabs: []
     property string querySelector: ""
-    // Shared WebChannel carrying the TLS proxy bridge
-    property var sharedWebChannel
 
     property alias contents: view
     property int currentTabIndex: 0
@@ -139,7 +137,6 @@ Item {
             "serviceId": view.serviceId,
             "initialUrl": url,
             "webProfile": view.webProfile,
-            "sharedWebChannel": view.sharedWebChannel,
             "isMuted": view.isMuted,
             "globalMute": view.globalMute,
             "querySelector": view.querySelector,
@@ -181,6 +178,13 @@ Item {
             view.notificationCountFromContent(svcId, count);
         });
 
+        // The page's own favicon replaces the third-party one in the sidebar
+        tabView.iconChanged.connect(function() {
+            if (typeof faviconCache !== "undefined" && faviconCache !== null && tabView.icon.toString() !== "") {
+                faviconCache.capturePageIcon(view.configuredUrl.toString(), tabView.url, tabView.icon);
+            }
+        });
+
         var newTabViews = Object.assign({}, tabViews);
         newTabViews[tabId] = tabView;
         tabViews = newTabViews;
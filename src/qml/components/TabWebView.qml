@@ -13,8 +13,6 @@ WebEngineView {
     property string serviceId: ""
     property url initialUrl: "about:blank"
     property WebEngineProfile webProfile
-    // Shared WebChannel carrying the TLS proxy bridge
-    property var sharedWebChannel
     property bool isMuted: false
     property bool globalMute: false
     property string querySelector: ""
@@ -32,7 +30,8 @@ WebEngineView {
     profile: webView.webProfile
     url: webView.initialUrl
     audioMuted: webView.isMuted || webView.globalMute
-    webChannel: webView.sharedWebChannel
+    // The profile's own, so the page only reaches its profile's proxy session
+    webChannel: webView.webProfile ? webView.webProfile.tlsProxyChannel : null
 
     onZoomFactorChanged: {
         webView.zoomUpdated(webView.zoomFactor);
@@ -90,8 +89,7 @@ WebEngineView {
             if (popupComponent.status === Component.Ready) {
                 var popup = popupComponent.createObject(null, {
                     "parentService": webView.serviceId,
-                    "webProfile": webView.webProfile,
-                    "sharedWebChannel": webView.sharedWebChannel
+                    "webProfile": webView.webProfile
                 });
                 if (popup) {
                     popup.show();
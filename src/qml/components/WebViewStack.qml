@@ -1,5 +1,6 @@
 import QtQuick
 import QtQuick.Layouts
+import QtWebChannel
 import QtWebEngine
 
 import "./" as Components
@@ -26,8 +27,6 @@ Item {
     property var notificationCountCallback: null
     // Workspace isolated storage info (provided by Main.qml)
     property var workspaceIsolatedStorage: ({})
-    // Shared WebChannel carrying the TLS proxy bridge (provided by Main.qml)
-    property var sharedWebChannel
 
     // Signal to propagate service URL update requests
     signal updateServiceUrlRequested(string serviceId, string newUrl)
@@ -416,7 +415,6 @@ Item {
             "initialUrl": initialUrl,
             "configuredUrl": serviceData.url,
             "webProfile": profileToUse,
-            "sharedWebChannel": root.sharedWebChannel,
             "isServiceDisabled": root.isDisabled(serviceData.id),
             "isMuted": root.mutedServices && root.mutedServices.hasOwnProperty(serviceData.id),
             "globalMute": root.globalMute,
@@ -636,7 +634,13 @@ Item {
             httpCacheType: WebEngineProfile.DiskHttpCache
             persistentCookiesPolicy: WebEngineProfile.ForcePersistentCookies
 
+            // This profile's own TLS proxy endpoint; see TlsProxyProfileBridge
+            readonly property WebChannel tlsProxyChannel: WebChannel {}
+
             Component.onCompleted: {
+                if (tlsProxyBridge) {
+                    tlsProxyChannel.registerObjects({ "tlsProxyBridge": tlsProxyBridge.forProfile(storageName) });
+                }
                 if (typeof tlsProxyShimSource !== "undefined" && tlsProxyShimSource !== "") {
                     var shim = WebEngine.script();
                     shim.name = "tlsProxyShim";
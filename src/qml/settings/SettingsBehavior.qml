@@ -82,6 +82,99 @@ Kirigami.ScrollablePage {
             }
         }
 
+        Kirigami.Separator {
+            Kirigami.FormData.label: i18nc("@title:group", "Icon Cache:")
+            Kirigami.FormData.isSection: true
+        }
+
+        QQC2.SpinBox {
+            Kirigami.FormData.label: i18nc("@label:spinbox", "Disk space limit:")
+            from: 10
+            to: 2048
+            stepSize: 10
+            value: configManager ? configManager.iconCacheBudgetMiB : 100
+            textFromValue: function (value) {
+                return i18nc("@item:valuesuffix size in mebibytes", "%1 MiB", value);
+            }
+            valueFromText: function (text) {
+                return parseInt(text);
+            }
+            onValueModified: {
+                if (configManager) {
+                    configManager.iconCacheBudgetMiB = value;
+                }
+            }
+        }
+
+        RowLayout {
+            Kirigami.FormData.label: i18nc("@label", "Usage:")
+
+            QQC2.Label {
+                readonly property var stats: faviconCache ? faviconCache.cacheStats : ({})
+                text: i18nc("@info icon cache usage", "%1 icons, %2 of %3 MiB, %4% hit rate",
+                            stats.entries || 0,
+                            ((stats.bytes || 0) / 1048576).toFixed(1),
+                            Math.round((stats.budget || 0) / 1048576),
+                            Math.round((stats.hitRate || 0) * 100))
+            }
+
+            QQC2.Button {
+                text: i18nc("@action:button", "Clear Cache")
+                icon.name: "edit-clear"
+                onClicked: faviconCache.clearCache()
+            }
+        }
+
+        Kirigami.Separator {
+            Kirigami.FormData.label: i18nc("@title:group", "Notifications:")
+            Kirigami.FormData.isSection: true
+        }
+
+        QQC2.SpinBox {
+            Kirigami.FormData.label: i18nc("@label:spinbox", "Group bursts within:")
+            from: 0
+            to: 300
+            value: configManager ? configManager.notificationBurstSeconds : 10
+            textFromValue: function (value) {
+                return value === 0 ? i18nc("@item:valuesuffix notification merging disabled", "Off") : i18ncp("@item:valuesuffix", "%1 second", "%1 seconds", value);
+            }
+            valueFromText: function (text) {
+                return parseInt(text) || 0;
+            }
+            onValueModified: {
+                if (configManager) {
+                    configManager.notificationBurstSeconds = value;
+                }
+            }
+        }
+
+        QQC2.SpinBox {
+            Kirigami.FormData.label: i18nc("@label:spinbox", "Per service limit:")
+            from: 0
+            to: 120
+            value: configManager ? configManager.notificationRateLimit : 10
+            textFromValue: function (value) {
+                return value === 0 ? i18nc("@item:valuesuffix no notification rate limit", "Unlimited") : i18ncp("@item:valuesuffix", "%1 per minute", "%1 per minute", value);
+            }
+            valueFromText: function (text) {
+                return parseInt(text) || 0;
+            }
+            onValueModified: {
+                if (configManager) {
+                    configManager.notificationRateLimit = value;
+                }
+            }
+        }
+
+        QQC2.Label {
+            Kirigami.FormData.label: i18nc("@label", "Since startup:")
+            readonly property var stats: notificationPresenter ? notificationPresenter.stats : ({})
+            text: i18nc("@info notification counters", "%1 shown, %2 grouped, %3 delayed by the limit",
+                        stats.shown || 0,
+                        stats.merged || 0,
+                        stats.suppressed || 0)
+        }
+
         Kirigami.Separator {
             Kirigami.FormData.label: i18nc("@title:group", "Experimental:")
             Kirigami.FormData.isSection: true
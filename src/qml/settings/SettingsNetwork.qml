@@ -32,6 +32,12 @@ Kirigami.ScrollablePage {
         });
     }
 
+    function formatBytes(bytes) {
+        if (bytes >= 1048576) return i18nc("@info byte size", "%1 MiB", (bytes / 1048576).toFixed(1));
+        if (bytes >= 1024) return i18nc("@info byte size", "%1 KiB", (bytes / 1024).toFixed(1));
+        return i18nc("@info byte size", "%1 B", bytes);
+    }
+
     Kirigami.FormLayout {
         anchors.fill: parent
 
@@ -96,6 +102,79 @@ Kirigami.ScrollablePage {
             }
         }
 
+        QQC2.CheckBox {
+            Kirigami.FormData.label: i18nc("@label:checkbox", "Compression:")
+            text: i18nc("@option:check", "Keep proxied responses compressed until the page decodes them")
+            checked: configManager ? configManager.tlsProxyPreserveCompression : true
+            onCheckedChanged: {
+                if (configManager) {
+                    configManager.tlsProxyPreserveCompression = checked;
+                }
+            }
+        }
+
+        Kirigami.Separator {
+            Kirigami.FormData.label: i18nc("@title:group", "Proxy Statistics:")
+            Kirigami.FormData.isSection: true
+        }
+
+        QQC2.Label {
+            visible: statsRepeater.count === 0
+            Kirigami.FormData.isSection: true
+            Layout.fillWidth: true
+            wrapMode: Text.WordWrap
+            text: i18nc("@info", "No requests have gone through the proxy yet.")
+        }
+
+        Repeater {
+            id: statsRepeater
+            model: tlsProxyTelemetry
+
+            delegate: ColumnLayout {
+                required property string host
+                required property var requests
+                required property var failures
+                required property var status4xx
+                required property var status5xx
+                required property var bytesIn
+                required property var bytesOut
+                required property double totalP50
+                required property double totalP95
+                required property double totalP99
+                required property double queueP50
+                required property double sidecarP50
+                required property double upstreamP50
+
+                Layout.fillWidth: true
+                spacing: 0
+
+                QQC2.Label {
+                    Layout.fillWidth: true
+                    text: host
+                    elide: Text.ElideRight
+                }
+
+                QQC2.Label {
+                    Layout.fillWidth: true
+                    wrapMode: Text.WordWrap
+                    opacity: 0.7
+                    font: Kirigami.Theme.smallFont
+                    text: i18nc("@info proxy statistics per host", "%1 requests, %2 failed, %3 client errors, %4 server errors · p50 %5 ms, p95 %6 ms, p99 %7 ms · median queue %8 ms, sidecar %9 ms, upstream %10 ms · %11 received, %12 sent",
+                                requests, failures, status4xx, status5xx,
+                                totalP50.toFixed(1), totalP95.toFixed(1), totalP99.toFixed(1),
+                                queueP50.toFixed(1), sidecarP50.toFixed(1), upstreamP50.toFixed(1),
+                                root.formatBytes(bytesIn), root.formatBytes(bytesOut))
+                }
+            }
+        }
+
+        QQC2.Button {
+            visible: statsRepeater.count > 0
+            text: i18nc("@action:button", "Reset Statistics")
+            icon.name: "edit-clear-history"
+            onClicked: tlsProxyTelemetry.reset()
+        }
+
         Kirigami.Separator {
             visible: suggestionsLabel.visible
             Kirigami.FormData.label: i18nc("@title:group", "Detected Hosts:")
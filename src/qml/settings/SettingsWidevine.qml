@@ -36,6 +36,13 @@ Kirigami.Page {
             }
         }
 
+        Kirigami.InlineMessage {
+            Layout.fillWidth: true
+            visible: widevineManager && widevineManager.pendingVersion !== ""
+            type: Kirigami.MessageType.Information
+            text: widevineManager ? i18n("Widevine %1 will be used after Unify restarts.", widevineManager.pendingVersion) : ""
+        }
+
         RowLayout {
             Layout.fillWidth: true
             spacing: Kirigami.Units.smallSpacing
@@ -58,6 +65,15 @@ Kirigami.Page {
                 }
             }
 
+            QQC2.Button {
+                Layout.fillWidth: true
+                text: widevineManager ? i18n("Roll Back to %1", widevineManager.previousVersion) : ""
+                icon.name: "edit-undo"
+                visible: widevineManager && widevineManager.previousVersion !== "" && widevineManager.pendingVersion === ""
+                enabled: widevineManager && !widevineManager.isInstalling
+                onClicked: widevineManager.rollback()
+            }
+
             QQC2.Button {
                 Layout.fillWidth: true
                 text: i18n("Uninstall")
@@ -72,6 +88,37 @@ Kirigami.Page {
             }
         }
 
+        ColumnLayout {
+            Layout.fillWidth: true
+            spacing: Kirigami.Units.smallSpacing
+            visible: widevineManager && widevineManager.isInstalling
+
+            QQC2.Label {
+                Layout.fillWidth: true
+                wrapMode: QQC2.Label.WordWrap
+                text: widevineManager ? widevineManager.statusMessage : ""
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+                spacing: Kirigami.Units.smallSpacing
+
+                QQC2.ProgressBar {
+                    Layout.fillWidth: true
+                    from: 0
+                    to: 100
+                    value: widevineManager ? widevineManager.downloadProgress : 0
+                    indeterminate: !widevineManager || !widevineManager.downloading
+                }
+
+                QQC2.Button {
+                    text: i18n("Cancel")
+                    icon.name: "dialog-cancel"
+                    onClicked: widevineManager.cancelInstallation()
+                }
+            }
+        }
+
         QQC2.Label {
             Layout.fillWidth: true
             wrapMode: QQC2.Label.WordWrap
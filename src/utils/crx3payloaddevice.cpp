@@ -0,0 +1,114 @@
+#include "crx3payloaddevice.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace
+{
+constexpr char CRX_MAGIC[] = {'C', 'r', '2', '4'};
+constexpr char ZIP_LOCAL_HEADER[] = {'P', 'K', '\x03', '\x04'};
+constexpr quint32 CRX_VERSION = 3;
+// Magic, version, header length
+constexpr qint64 CRX_PREAMBLE_SIZE = 12;
+}
+
+Crx3PayloadDevice::Crx3PayloadDevice(const QString &crxPath, QObject *parent)
+    : QIODevice(parent)
+    , m_file(crxPath)
+{
+}
+
+Crx3PayloadDevice::~Crx3PayloadDevice()
+{
+    close();
+}
+
+bool Crx3PayloadDevice::open(OpenMode mode)
+{
+    if ((mode & ReadWrite) != ReadOnly) {
+        setErrorString(QStringLiteral("CRX payloads are read-only"));
+        return false;
+    }
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        setErrorString(m_file.errorString());
+        return false;
+    }
+    if (!readHeader()) {
+        m_file.close();
+        return false;
+    }
+    // Every read goes straight to the file at the mapped offset
+    return QIODevice::open(mode | Unbuffered);
+}
+
+bool Crx3PayloadDevice::readHeader()
+{
+    char preamble[CRX_PREAMBLE_SIZE];
+    if (m_file.read(preamble, CRX_PREAMBLE_SIZE) != CRX_PREAMBLE_SIZE || !std::equal(std::begin(CRX_MAGIC), std::end(CRX_MAGIC), preamble)) {
+        setErrorString(QStringLiteral("Not a CRX file"));
+        return false;
+    }
+    const quint32 version = qFromLittleEndian<quint32>(preamble + 4);
+    if (version != CRX_VERSION) {
+        setErrorString(QStringLiteral("Unsupported CRX version %1").arg(version));
+        return false;
+    }
+
+    m_payloadOffset = CRX_PREAMBLE_SIZE + qFromLittleEndian<quint32>(preamble + 8);
+    m_payloadSize = m_file.size() - m_payloadOffset;
+    char signature[sizeof(ZIP_LOCAL_HEADER)];
+    if (m_payloadSize < qint64(sizeof(signature)) || !m_file.seek(m_payloadOffset) || m_file.read(signature, sizeof(signature)) != qint64(sizeof(signature))
+        || !std::equal(std::begin(ZIP_LOCAL_HEADER), std::end(ZIP_LOCAL_HEADER), signature)) {
+        setErrorString(QStringLiteral("CRX header length does not point at a ZIP archive"));
+        return false;
+    }
+    return m_file.seek(m_payloadOffset);
+}
+
+void Crx3PayloadDevice::close()
+{
+    if (isOpen()) {
+        QIODevice::close();
+    }
+    m_file.close();
+}
+
+bool Crx3PayloadDevice::isSequential() const
+{
+    return false;
+}
+
+qint64 Crx3PayloadDevice::size() const
+{
+    return m_payloadSize;
+}
+
+bool Crx3PayloadDevice::seek(qint64 pos)
+{
+    if (pos < 0 || pos > m_payloadSize) {
+        return false;
+    }
+    return QIODevice::seek(pos) && m_file.seek(m_payloadOffset + pos);
+}
+
+qint64 Crx3PayloadDevice::payloadOffset() const
+{
+    return m_payloadOffset;
+}
+
+qint64 Crx3PayloadDevice::readData(char *data, qint64 maxSize)
+{
+    const qint64 available = m_payloadSize - (m_file.pos() - m_payloadOffset);
+    if (available <= 0) {
+        return 0;
+    }
+    return m_file.read(data, std::min(maxSize, available));
+}
+
+qint64 Crx3PayloadDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
@@ -0,0 +1,40 @@
+#ifndef CRX3PAYLOADDEVICE_H
+#define CRX3PAYLOADDEVICE_H
+
+#include <QFile>
+#include <QIODevice>
+
+// Read-only view of the ZIP archive inside a CRX3 package, positioned after
+// its header so KZip can read it in place instead of from a copy.
+//
+// CRX3 layout: "Cr24", version (uint32 LE, 3), header length (uint32 LE),
+// the protobuf header of that length, then the ZIP. open() validates all of
+// it and fails with errorString() set on anything else.
+class Crx3PayloadDevice : public QIODevice
+{
+public:
+    explicit Crx3PayloadDevice(const QString &crxPath, QObject *parent = nullptr);
+    ~Crx3PayloadDevice() override;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override;
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+
+    // Where the ZIP starts in the CRX file, once open
+    qint64 payloadOffset() const;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    bool readHeader();
+
+    QFile m_file;
+    qint64 m_payloadOffset = 0;
+    qint64 m_payloadSize = 0;
+};
+
+#endif // CRX3PAYLOADDEVICE_H
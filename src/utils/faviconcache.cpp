@@ -1,22 +1,799 @@
 #include "faviconcache.h"
+#include "faviconimageprovider.h"
+#include "publicsuffix.h"
 
+#include <QBuffer>
 #include <QCryptographicHash>
+#include <QDateTime>
 #include <QDir>
+#include <QDirIterator>
 #include <QFile>
 #include <QFileInfo>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQmlEngine>
+#include <QQuickImageProvider>
+#include <QSaveFile>
 #include <QStandardPaths>
+#include <QThreadPool>
 #include <QUrl>
 #include <QDebug>
 
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace
+{
+// Enough for a few hundred decoded 128px icons at their sidebar sizes
+constexpr qint64 DECODED_IMAGE_BUDGET = 32 * 1024 * 1024;
+
+constexpr qint64 DEFAULT_DISK_BUDGET = 100 * 1024 * 1024;
+constexpr int MAINTENANCE_DELAY_MS = 2000;
+constexpr int INDEX_VERSION = 1;
+
+constexpr qint64 REVALIDATE_AFTER_MS = 7LL * 24 * 60 * 60 * 1000;
+// Stale entries are refreshed no faster than this, so a startup with an old
+// cache doesn't hit Google and icon.horse with every icon at once
+constexpr int REVALIDATION_INTERVAL_MS = 2000;
+
+// Startup asks for every service icon at once; the rest wait in the queue
+constexpr int MAX_CONCURRENT_DOWNLOADS = 4;
+// A stalled endpoint would otherwise hold a download slot forever
+constexpr int DOWNLOAD_TIMEOUT_MS = 30000;
+
+// Page icons are stored at the size third-party icons are requested at; ones
+// below the minimum would look blurry next to them in the sidebar
+constexpr int PAGE_ICON_SIZE = 128;
+constexpr int MIN_PAGE_ICON_SIZE = 32;
+
+// A failed request waits 15 minutes, doubling per failure up to a day
+constexpr qint64 FAILURE_BACKOFF_MS = 15LL * 60 * 1000;
+constexpr qint64 MAX_FAILURE_BACKOFF_MS = 24LL * 60 * 60 * 1000;
+
+QString indexPath(const QString &cacheDir)
+{
+    return cacheDir + QStringLiteral("/index.json");
+}
+
+QString sourceForPath(const QString &relativePath)
+{
+    if (relativePath.startsWith(QLatin1String("favicons/google/"))) {
+        return QStringLiteral("google");
+    }
+    if (relativePath.startsWith(QLatin1String("favicons/iconhorse/"))) {
+        return QStringLiteral("iconhorse");
+    }
+    if (relativePath.startsWith(QLatin1String("favicons/page/"))) {
+        return QStringLiteral("page");
+    }
+    if (relativePath.startsWith(QLatin1String("images/"))) {
+        return QStringLiteral("image");
+    }
+    return QString();
+}
+
+QString blobPath(const QString &cacheDir, const QByteArray &hash)
+{
+    return cacheDir + QStringLiteral("/blobs/") + QString::fromLatin1(hash);
+}
+
+// Relative, so the cache keeps working if the directory moves
+bool linkToBlob(const QString &linkPath, const QString &blobPath)
+{
+    QFile::remove(linkPath);
+    return QFile::link(QFileInfo(linkPath).dir().relativeFilePath(blobPath), linkPath);
+}
+
+// Catches error pages served with 200 and bodies cut short
+bool isDecodableImage(const QByteArray &data)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    return reader.canRead() && !reader.read().isNull();
+}
+
+QString withoutVersion(const QString &url)
+{
+    return url.section(QLatin1Char('?'), 0, 0);
+}
+
+QByteArray contentHash(const QByteArray &data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+}
+
+void writeFileAtomically(const QString &path, const QByteArray &data)
+{
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(data);
+        file.commit();
+    }
+}
+
+QString md5Hex(const QString &value)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(value.toUtf8(), QCryptographicHash::Md5).toHex());
+}
+
+void createCacheDirs(const QString &cacheDir)
+{
+    QDir().mkpath(cacheDir + QStringLiteral("/favicons/google"));
+    QDir().mkpath(cacheDir + QStringLiteral("/favicons/iconhorse"));
+    QDir().mkpath(cacheDir + QStringLiteral("/favicons/page"));
+    QDir().mkpath(cacheDir + QStringLiteral("/images"));
+    QDir().mkpath(cacheDir + QStringLiteral("/blobs"));
+}
+}
+
 FaviconCache::FaviconCache(QObject *parent)
     : QObject(parent)
     , m_networkManager(new QNetworkAccessManager(this))
+    , m_maintenanceTimer(new QTimer(this))
+    , m_diskBudget(DEFAULT_DISK_BUDGET)
+    , m_revalidationTimer(new QTimer(this))
 {
     m_cacheDir = getCacheDir();
-    QDir().mkpath(m_cacheDir);
-    QDir().mkpath(m_cacheDir + QStringLiteral("/favicons/google"));
-    QDir().mkpath(m_cacheDir + QStringLiteral("/favicons/iconhorse"));
-    QDir().mkpath(m_cacheDir + QStringLiteral("/images"));
+    m_networkManager->setTransferTimeout(DOWNLOAD_TIMEOUT_MS);
+    // Saves land in the order they were made, after the scan
+    m_ioPool.setMaxThreadCount(1);
+
+    m_maintenanceTimer->setSingleShot(true);
+    m_maintenanceTimer->setInterval(MAINTENANCE_DELAY_MS);
+    connect(m_maintenanceTimer, &QTimer::timeout, this, &FaviconCache::runMaintenance);
+
+    m_revalidationTimer->setInterval(REVALIDATION_INTERVAL_MS);
+    connect(m_revalidationTimer, &QTimer::timeout, this, &FaviconCache::revalidateNext);
+
+    // Called from the image loader threads: only touches the immutable cache dir
+    const QString cacheDir = m_cacheDir;
+    m_imageStore = std::make_shared<FaviconImageStore>(
+        [cacheDir](const QString &id) -> QString {
+            const qsizetype slash = id.indexOf(QLatin1Char('/'));
+            const QString kind = id.left(slash);
+            const QString name = id.mid(slash + 1);
+            if (slash <= 0 || name.isEmpty() || name.contains(QLatin1Char('/')) || name.startsWith(QLatin1Char('.'))) {
+                return QString();
+            }
+            if (kind == QLatin1String("google") || kind == QLatin1String("iconhorse") || kind == QLatin1String("page")) {
+                return cacheDir + QStringLiteral("/favicons/") + kind + QLatin1Char('/') + md5Hex(name) + QStringLiteral(".png");
+            }
+            if (kind == QLatin1String("image")) {
+                return cacheDir + QStringLiteral("/images/") + name;
+            }
+            return QString();
+        },
+        DECODED_IMAGE_BUDGET);
+
+    startIndexScan();
+}
+
+void FaviconCache::startIndexScan()
+{
+    const QString cacheDir = m_cacheDir;
+    const int generation = m_indexGeneration;
+    m_ioPool.start([this, cacheDir, generation]() {
+        const IndexSnapshot snapshot = scanDisk(cacheDir);
+        QMetaObject::invokeMethod(
+            this,
+            [this, snapshot, generation]() {
+                onIndexScanned(snapshot, generation);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+FaviconCache::~FaviconCache()
+{
+    // A scan still running would post its result to a deleted object, and a
+    // queued index save could overwrite the one below
+    m_ioPool.waitForDone();
+
+    // Last-access times since the last maintenance run would be lost otherwise
+    if (m_indexReady && m_indexDirty) {
+        writeFileAtomically(indexPath(m_cacheDir), serializeIndex());
+    }
+}
+
+FaviconCache::IndexSnapshot FaviconCache::scanDisk(const QString &cacheDir)
+{
+    createCacheDirs(cacheDir);
+
+    // Persisted metadata is kept while the link still points at the same blob;
+    // plain files left by older versions are validated and moved into blobs/
+    QJsonObject persisted;
+    IndexSnapshot snapshot;
+    QFile indexFile(indexPath(cacheDir));
+    if (indexFile.open(QIODevice::ReadOnly)) {
+        const QJsonObject root = QJsonDocument::fromJson(indexFile.readAll()).object();
+        if (root.value(QStringLiteral("version")).toInt() == INDEX_VERSION) {
+            persisted = root.value(QStringLiteral("entries")).toObject();
+            const QJsonObject failures = root.value(QStringLiteral("failures")).toObject();
+            for (auto it = failures.constBegin(); it != failures.constEnd(); ++it) {
+                const QJsonObject saved = it.value().toObject();
+                FailureEntry failure;
+                failure.failures = saved.value(QStringLiteral("failures")).toInt();
+                failure.retryAt = saved.value(QStringLiteral("retryAt")).toInteger();
+                snapshot.failures.insert(it.key(), failure);
+            }
+        }
+    }
+
+    QHash<QString, DiskEntry> &entries = snapshot.entries;
+    QSet<QByteArray> referenced;
+    const QStringList linkDirs{QStringLiteral("favicons/google"),
+                               QStringLiteral("favicons/iconhorse"),
+                               QStringLiteral("favicons/page"),
+                               QStringLiteral("images")};
+    for (const QString &linkDir : linkDirs) {
+        // System: dangling links are only listed with it
+        QDirIterator it(cacheDir + QLatin1Char('/') + linkDir, QDir::Files | QDir::System | QDir::Hidden);
+        while (it.hasNext()) {
+            const QString path = it.next();
+            const QFileInfo info = it.fileInfo();
+            QByteArray hash;
+            if (info.isSymLink()) {
+                hash = QFileInfo(info.symLinkTarget()).fileName().toLatin1();
+            } else {
+                // Written in place by older versions, possibly cut short by a crash
+                QFile file(path);
+                const QByteArray data = file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+                file.close();
+                if (isDecodableImage(data)) {
+                    hash = contentHash(data);
+                    const QString blob = blobPath(cacheDir, hash);
+                    const bool moved = QFile::exists(blob) ? QFile::remove(path) : QFile::rename(path, blob);
+                    if (!moved || !linkToBlob(path, blob)) {
+                        hash.clear();
+                    }
+                }
+            }
+
+            const QFileInfo blob(blobPath(cacheDir, hash));
+            if (hash.isEmpty() || !blob.exists()) {
+                QFile::remove(path);
+                continue;
+            }
+
+            const QString relativePath = path.mid(cacheDir.size() + 1);
+            const QJsonObject saved = persisted.value(relativePath).toObject();
+            DiskEntry entry;
+            entry.source = sourceForPath(relativePath);
+            entry.contentHash = hash;
+            entry.size = blob.size();
+            if (saved.value(QStringLiteral("hash")).toString().toLatin1() == hash) {
+                entry.id = saved.value(QStringLiteral("id")).toString();
+                entry.lastAccess = saved.value(QStringLiteral("lastAccess")).toInteger();
+                entry.url = saved.value(QStringLiteral("url")).toString();
+                entry.etag = saved.value(QStringLiteral("etag")).toString().toLatin1();
+                entry.lastModified = saved.value(QStringLiteral("lastModified")).toString().toLatin1();
+                entry.fetchedAt = saved.value(QStringLiteral("fetchedAt")).toInteger(blob.lastModified().toMSecsSinceEpoch());
+            } else {
+                entry.lastAccess = blob.lastModified().toMSecsSinceEpoch();
+                entry.fetchedAt = entry.lastAccess;
+            }
+            entries.insert(path, entry);
+            referenced.insert(hash);
+        }
+    }
+
+    // Blobs whose last link was evicted at shutdown, and QSaveFile leftovers
+    QDirIterator blobs(cacheDir + QStringLiteral("/blobs"), QDir::Files | QDir::Hidden);
+    while (blobs.hasNext()) {
+        const QString path = blobs.next();
+        if (!referenced.contains(blobs.fileName().toLatin1())) {
+            QFile::remove(path);
+        }
+    }
+    return snapshot;
+}
+
+void FaviconCache::onIndexScanned(const IndexSnapshot &snapshot, int generation)
+{
+    // clearCache() ran meanwhile: the scanned files are gone
+    if (generation == m_indexGeneration) {
+        for (auto it = snapshot.entries.cbegin(); it != snapshot.entries.cend(); ++it) {
+            if (!m_diskIndex.contains(it.key())) {
+                m_diskIndex.insert(it.key(), it.value());
+                retainBlob(it->contentHash, it->size);
+            }
+        }
+        for (auto it = snapshot.failures.cbegin(); it != snapshot.failures.cend(); ++it) {
+            if (!m_failures.contains(it.key())) {
+                m_failures.insert(it.key(), it.value());
+            }
+        }
+    }
+    m_indexReady = true;
+    m_indexDirty = true;
+    scheduleMaintenance();
+
+    const QHash<QString, std::function<void()>> deferred = std::exchange(m_deferredLookups, {});
+    for (const auto &lookup : deferred) {
+        lookup();
+    }
+}
+
+bool FaviconCache::lookupOnDisk(const QString &cachePath, const QString &id, const QString &origin)
+{
+    auto it = m_diskIndex.find(cachePath);
+    if (it == m_diskIndex.end()) {
+        return false;
+    }
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    it->id = id;
+    it->lastAccess = now;
+    ++m_diskHits;
+    prescale(id);
+    m_indexDirty = true;
+    scheduleMaintenance();
+
+    // Served as is either way; a changed file is announced once downloaded.
+    // Page icons are refreshed by the pages themselves.
+    if (it->source != QLatin1String("page") && now - it->fetchedAt > REVALIDATE_AFTER_MS) {
+        queueRevalidation(cachePath, origin);
+    }
+    return true;
+}
+
+bool FaviconCache::storeDownload(const QString &cachePath, const QString &id, const QByteArray &data, const QNetworkReply *reply)
+{
+    const QByteArray hash = contentHash(data);
+    const QString blob = blobPath(m_cacheDir, hash);
+
+    // Identical icons, like the default globe many hosts get, are stored once.
+    // A referenced blob is still checked for: linking to a missing one would
+    // leave every host sharing it without an icon.
+    if (!m_blobRefs.contains(hash) || !QFile::exists(blob)) {
+        QSaveFile file(blob);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            qWarning() << "Failed to write" << blob << ":" << file.errorString();
+            return false;
+        }
+    }
+    if (!linkToBlob(cachePath, blob)) {
+        qWarning() << "Failed to link" << cachePath << "to" << blob;
+        return false;
+    }
+
+    DiskEntry &entry = m_diskIndex[cachePath];
+    if (entry.contentHash != hash) {
+        if (releaseBlob(entry.contentHash, entry.size)) {
+            QFile::remove(blobPath(m_cacheDir, entry.contentHash));
+        }
+        retainBlob(hash, data.size());
+    }
+    entry.id = id;
+    entry.source = sourceForPath(cachePath.mid(m_cacheDir.size() + 1));
+    entry.contentHash = hash;
+    entry.size = data.size();
+    entry.lastAccess = QDateTime::currentMSecsSinceEpoch();
+    entry.url = reply ? reply->request().url().toString() : QString();
+    entry.etag = reply ? reply->rawHeader("ETag") : QByteArray();
+    entry.lastModified = reply ? reply->rawHeader("Last-Modified") : QByteArray();
+    entry.fetchedAt = entry.lastAccess;
+    m_indexDirty = true;
+    scheduleMaintenance();
+
+    m_imageStore->invalidate(id);
+    m_prescaled.remove(id);
+    prescale(id);
+    return true;
+}
+
+void FaviconCache::retainBlob(const QByteArray &hash, qint64 size)
+{
+    if (m_blobRefs[hash]++ == 0) {
+        m_diskBytes += size;
+    }
+}
+
+bool FaviconCache::releaseBlob(const QByteArray &hash, qint64 size)
+{
+    auto it = m_blobRefs.find(hash);
+    if (it == m_blobRefs.end() || --it.value() > 0) {
+        return false;
+    }
+    m_blobRefs.erase(it);
+    m_diskBytes -= size;
+    return true;
+}
+
+void FaviconCache::queueRevalidation(const QString &cachePath, const QString &origin)
+{
+    if (m_revalidationOrigins.contains(cachePath)) {
+        return;
+    }
+    m_revalidationOrigins.insert(cachePath, origin);
+    m_revalidationQueue.append(cachePath);
+    if (!m_revalidationTimer->isActive()) {
+        m_revalidationTimer->start();
+    }
+}
+
+void FaviconCache::revalidateNext()
+{
+    if (m_revalidationQueue.isEmpty()) {
+        m_revalidationTimer->stop();
+        return;
+    }
+
+    const QString cachePath = m_revalidationQueue.takeFirst();
+    auto it = m_diskIndex.constFind(cachePath);
+    if (it == m_diskIndex.cend()) {
+        m_revalidationOrigins.remove(cachePath);
+        return;
+    }
+
+    // Files cached before downloads were recorded: ask the endpoint they came from
+    QString url = it->url;
+    if (url.isEmpty()) {
+        const QString name = it->id.section(QLatin1Char('/'), 1);
+        if (it->id.startsWith(QLatin1String("google/"))) {
+            url = m_googleUrlTemplate.arg(name);
+        } else if (it->id.startsWith(QLatin1String("iconhorse/"))) {
+            url = m_iconHorseUrlTemplate.arg(name);
+        } else {
+            url = m_revalidationOrigins.value(cachePath);
+        }
+    }
+
+    QNetworkRequest request{QUrl(url)};
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    request.setRawHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:145.0) Gecko/20100101 Firefox/145.0");
+    if (!it->etag.isEmpty()) {
+        request.setRawHeader("If-None-Match", it->etag);
+    }
+    if (!it->lastModified.isEmpty()) {
+        request.setRawHeader("If-Modified-Since", it->lastModified);
+    }
+
+    QNetworkReply *reply = m_networkManager->get(request);
+    reply->setProperty("cachePath", cachePath);
+    connect(reply, &QNetworkReply::finished, this, &FaviconCache::onRevalidated);
+}
+
+void FaviconCache::onRevalidated()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply) {
+        return;
+    }
+    reply->deleteLater();
+
+    const QString cachePath = reply->property("cachePath").toString();
+    const QString origin = m_revalidationOrigins.take(cachePath);
+    auto it = m_diskIndex.find(cachePath);
+    if (it == m_diskIndex.end()) {
+        // Evicted or cleared while the request was in flight
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    m_indexDirty = true;
+    scheduleMaintenance();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        // Keep serving the cached file and try again after another TTL
+        qWarning() << "Failed to revalidate" << it->id << ":" << reply->errorString();
+        it->fetchedAt = now;
+        return;
+    }
+
+    const QByteArray data = reply->readAll();
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 304 || !isDecodableImage(data) || contentHash(data) == it->contentHash) {
+        it->fetchedAt = now;
+        if (reply->hasRawHeader("ETag")) {
+            it->etag = reply->rawHeader("ETag");
+        }
+        if (reply->hasRawHeader("Last-Modified")) {
+            it->lastModified = reply->rawHeader("Last-Modified");
+        }
+        return;
+    }
+
+    const QString id = it->id;
+    if (!storeDownload(cachePath, id, data, reply)) {
+        return;
+    }
+    const QString url = localUrl(cachePath, id);
+
+    if (id.startsWith(QLatin1String("image/"))) {
+        m_imageCache.insert(origin, url);
+        Q_EMIT imageReady(origin, url);
+        return;
+    }
+
+    const QString hostname = id.section(QLatin1Char('/'), 1);
+    const FaviconSource source = id.startsWith(QLatin1String("google/")) ? GoogleSource : IconHorseSource;
+    (source == GoogleSource ? m_googleFaviconCache : m_iconHorseFaviconCache).insert(hostname, url);
+    if (withoutVersion(m_faviconCache.value(hostname)) == providerUrl(id)) {
+        m_faviconCache.insert(hostname, url);
+        Q_EMIT faviconReady(origin, url);
+    }
+    Q_EMIT faviconSourceReady(origin, static_cast<int>(source), url);
+}
+
+void FaviconCache::scheduleMaintenance()
+{
+    if (!m_maintenanceTimer->isActive()) {
+        m_maintenanceTimer->start();
+    }
+}
+
+void FaviconCache::runMaintenance()
+{
+    if (!m_indexReady) {
+        return;
+    }
+
+    if (m_diskBytes > m_diskBudget) {
+        // Down to 90% of the budget so a full cache doesn't evict on every write
+        const qint64 target = m_diskBudget / 10 * 9;
+        QList<QPair<qint64, QString>> byLastAccess;
+        byLastAccess.reserve(m_diskIndex.size());
+        for (auto it = m_diskIndex.cbegin(); it != m_diskIndex.cend(); ++it) {
+            byLastAccess.append({it->lastAccess, it.key()});
+        }
+        std::sort(byLastAccess.begin(), byLastAccess.end());
+
+        // Removed right away: a deferred removal could delete a file the same
+        // host, or an icon with the same content, was downloaded to meanwhile
+        for (const auto &candidate : std::as_const(byLastAccess)) {
+            const QString &path = candidate.second;
+            if (m_diskBytes <= target) {
+                break;
+            }
+            const DiskEntry entry = m_diskIndex.take(path);
+            forgetCachedUrl(entry.id);
+            QFile::remove(path);
+            if (releaseBlob(entry.contentHash, entry.size)) {
+                QFile::remove(blobPath(m_cacheDir, entry.contentHash));
+            }
+        }
+        m_indexDirty = true;
+    }
+
+    if (m_indexDirty) {
+        m_indexDirty = false;
+        const QString path = indexPath(m_cacheDir);
+        const QByteArray data = serializeIndex();
+        m_ioPool.start([path, data]() {
+            writeFileAtomically(path, data);
+        });
+    }
+    Q_EMIT cacheStatsChanged();
+}
+
+void FaviconCache::forgetCachedUrl(const QString &id)
+{
+    if (id.isEmpty()) {
+        return;
+    }
+    m_imageStore->invalidate(id);
+    m_prescaled.remove(id);
+    const QString url = providerUrl(id);
+    const QString name = id.section(QLatin1Char('/'), 1);
+    if (id.startsWith(QLatin1String("image/"))) {
+        m_imageCache.removeIf([&url](const QHash<QString, QString>::iterator it) {
+            return withoutVersion(it.value()) == url;
+        });
+        return;
+    }
+    if (id.startsWith(QLatin1String("google/"))) {
+        m_googleFaviconCache.remove(name);
+    } else if (id.startsWith(QLatin1String("iconhorse/"))) {
+        m_iconHorseFaviconCache.remove(name);
+    }
+    if (withoutVersion(m_faviconCache.value(name)) == url) {
+        m_faviconCache.remove(name);
+    }
+}
+
+QByteArray FaviconCache::serializeIndex() const
+{
+    QJsonObject entries;
+    for (auto it = m_diskIndex.cbegin(); it != m_diskIndex.cend(); ++it) {
+        entries.insert(it.key().mid(m_cacheDir.size() + 1),
+                       QJsonObject{{QStringLiteral("id"), it->id},
+                                   {QStringLiteral("source"), it->source},
+                                   {QStringLiteral("hash"), QString::fromLatin1(it->contentHash)},
+                                   {QStringLiteral("size"), it->size},
+                                   {QStringLiteral("lastAccess"), it->lastAccess},
+                                   {QStringLiteral("url"), it->url},
+                                   {QStringLiteral("etag"), QString::fromLatin1(it->etag)},
+                                   {QStringLiteral("lastModified"), QString::fromLatin1(it->lastModified)},
+                                   {QStringLiteral("fetchedAt"), it->fetchedAt}});
+    }
+    // Expired failures are dropped; their next attempt goes to the network anyway
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QJsonObject failures;
+    for (auto it = m_failures.cbegin(); it != m_failures.cend(); ++it) {
+        if (it->retryAt > now) {
+            failures.insert(it.key(), QJsonObject{{QStringLiteral("failures"), it->failures}, {QStringLiteral("retryAt"), it->retryAt}});
+        }
+    }
+    const QJsonObject root{{QStringLiteral("version"), INDEX_VERSION},
+                           {QStringLiteral("entries"), entries},
+                           {QStringLiteral("failures"), failures}};
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+qint64 FaviconCache::diskBudget() const
+{
+    return m_diskBudget;
+}
+
+void FaviconCache::setDiskBudget(qint64 bytes)
+{
+    bytes = qMax<qint64>(0, bytes);
+    if (m_diskBudget == bytes) {
+        return;
+    }
+    m_diskBudget = bytes;
+    scheduleMaintenance();
+}
+
+QVariantMap FaviconCache::cacheStats() const
+{
+    const qint64 lookups = m_diskHits + m_diskMisses;
+    const FaviconImageStore::Stats memory = m_imageStore->stats();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const qsizetype backedOff = std::count_if(m_failures.cbegin(), m_failures.cend(), [now](const FailureEntry &failure) {
+        return failure.retryAt > now;
+    });
+    return {{QStringLiteral("entries"), m_diskIndex.size()},
+            {QStringLiteral("blobs"), m_blobRefs.size()},
+            {QStringLiteral("bytes"), m_diskBytes},
+            {QStringLiteral("budget"), m_diskBudget},
+            {QStringLiteral("hits"), m_diskHits},
+            {QStringLiteral("misses"), m_diskMisses},
+            {QStringLiteral("hitRate"), lookups > 0 ? double(m_diskHits) / lookups : 0.0},
+            {QStringLiteral("backedOff"), backedOff},
+            {QStringLiteral("memoryEntries"), memory.entries},
+            {QStringLiteral("memoryBytes"), memory.bytes},
+            {QStringLiteral("memoryHits"), memory.hits},
+            {QStringLiteral("memoryMisses"), memory.misses}};
+}
+
+void FaviconCache::deferUntilIndexed(const QString &key, std::function<void()> lookup)
+{
+    if (!m_deferredLookups.contains(key)) {
+        m_deferredLookups.insert(key, std::move(lookup));
+    }
+}
+
+void FaviconCache::registerImageProvider(QQmlEngine *engine)
+{
+    m_engine = engine;
+    engine->addImageProvider(QStringLiteral("serviceicon"), new FaviconImageProvider(m_imageStore));
+}
+
+void FaviconCache::capturePageIcon(const QString &serviceUrl, const QUrl &pageUrl, const QUrl &iconUrl)
+{
+    const QString hostname = extractHostname(serviceUrl);
+    if (hostname.isEmpty() || !m_engine || iconUrl.scheme() != QLatin1String("image")) {
+        return;
+    }
+    // Login redirects and links opened in a service tab show other sites' icons
+    if (extractRootDomain(pageUrl.host()) != extractRootDomain(hostname)) {
+        return;
+    }
+
+    // QtWebEngine's image://favicon provider, which knows the icons of every view
+    auto *provider = dynamic_cast<QQuickAsyncImageProvider *>(m_engine->imageProvider(iconUrl.host()));
+    if (!provider) {
+        return;
+    }
+    const QString id = iconUrl.toString(QUrl::RemoveScheme | QUrl::RemoveAuthority).mid(1);
+    QQuickImageResponse *response = provider->requestImageResponse(id, QSize(PAGE_ICON_SIZE, PAGE_ICON_SIZE));
+    connect(response, &QQuickImageResponse::finished, this, [this, response, serviceUrl, hostname]() {
+        response->deleteLater();
+        if (!response->errorString().isEmpty()) {
+            return;
+        }
+        const std::unique_ptr<QQuickTextureFactory> factory(response->textureFactory());
+        if (factory) {
+            storePageIcon(serviceUrl, hostname, factory->image());
+        }
+    });
+}
+
+void FaviconCache::setPrescaledVariants(const QVariantList &pixelSizes, int cornerRadius)
+{
+    QList<int> sizes;
+    for (const QVariant &size : pixelSizes) {
+        if (size.toInt() > 0 && !sizes.contains(size.toInt())) {
+            sizes.append(size.toInt());
+        }
+    }
+    if (sizes == m_variantSizes && cornerRadius == m_variantRadius) {
+        return;
+    }
+    m_variantSizes = sizes;
+    m_variantRadius = cornerRadius;
+
+    const QSet<QString> ids = std::exchange(m_prescaled, {});
+    for (const QString &id : ids) {
+        prescale(id);
+    }
+}
+
+void FaviconCache::setEndpointsForTesting(const QString &googleTemplate, const QString &iconHorseTemplate)
+{
+    m_googleUrlTemplate = googleTemplate;
+    m_iconHorseUrlTemplate = iconHorseTemplate;
+}
+
+void FaviconCache::setTransferTimeoutForTesting(int msecs)
+{
+    m_networkManager->setTransferTimeout(msecs);
+}
+
+void FaviconCache::prescale(const QString &id)
+{
+    if (m_variantSizes.isEmpty() || m_prescaled.contains(id)) {
+        return;
+    }
+    m_prescaled.insert(id);
+    QThreadPool::globalInstance()->start([store = m_imageStore, id, sizes = m_variantSizes, radius = m_variantRadius]() {
+        for (int size : sizes) {
+            store->image(id, QSize(size, size), radius);
+        }
+    });
+}
+
+void FaviconCache::storePageIcon(const QString &serviceUrl, const QString &hostname, const QImage &image)
+{
+    if (image.isNull() || qMax(image.width(), image.height()) < MIN_PAGE_ICON_SIZE) {
+        return;
+    }
+    // Pages report their icons during startup too. A link written while the
+    // scan runs could lose its blob as an orphan; the latest icon is kept.
+    if (!m_indexReady) {
+        const QString key = QStringLiteral("page|") + serviceUrl;
+        m_deferredLookups.remove(key);
+        deferUntilIndexed(key, [this, serviceUrl, hostname, image]() {
+            storePageIcon(serviceUrl, hostname, image);
+        });
+        return;
+    }
+    const QImage scaled = image.width() > PAGE_ICON_SIZE || image.height() > PAGE_ICON_SIZE
+        ? image.scaled(PAGE_ICON_SIZE, PAGE_ICON_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation)
+        : image;
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    if (!scaled.save(&buffer, "PNG")) {
+        return;
+    }
+
+    // Every page load reports the icon again; only a new one is worth a signal
+    const QString cachePath = getFaviconCachePath(hostname, PageSource);
+    if (m_diskIndex.value(cachePath).contentHash == contentHash(data)) {
+        return;
+    }
+    const QString id = faviconId(hostname, PageSource);
+    if (!storeDownload(cachePath, id, data, nullptr)) {
+        return;
+    }
+    const QString localUrl = this->localUrl(cachePath, id);
+    m_faviconCache.insert(hostname, localUrl);
+    Q_EMIT faviconReady(serviceUrl, localUrl);
+}
+
+QVariantMap FaviconCache::memoryCacheStats() const
+{
+    const FaviconImageStore::Stats stats = m_imageStore->stats();
+    return {{QStringLiteral("hits"), stats.hits},
+            {QStringLiteral("misses"), stats.misses},
+            {QStringLiteral("entries"), stats.entries},
+            {QStringLiteral("bytes"), stats.bytes}};
 }
 
 QString FaviconCache::getCacheDir() const
@@ -26,7 +803,39 @@ QString FaviconCache::getCacheDir() const
 
 QString FaviconCache::hashUrl(const QString &url) const
 {
-    return QString::fromLatin1(QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Md5).toHex());
+    return md5Hex(url);
+}
+
+QString FaviconCache::faviconId(const QString &hostname, FaviconSource source) const
+{
+    switch (source) {
+    case GoogleSource:
+        return QStringLiteral("google/") + hostname;
+    case IconHorseSource:
+        return QStringLiteral("iconhorse/") + hostname;
+    case PageSource:
+        return QStringLiteral("page/") + hostname;
+    }
+    return QString();
+}
+
+QString FaviconCache::imageId(const QString &imageUrl) const
+{
+    return QStringLiteral("image/") + QFileInfo(getImageCachePath(imageUrl)).fileName();
+}
+
+QString FaviconCache::providerUrl(const QString &id) const
+{
+    return QStringLiteral("image://serviceicon/") + id;
+}
+
+QString FaviconCache::localUrl(const QString &cachePath, const QString &id) const
+{
+    const QByteArray hash = m_diskIndex.value(cachePath).contentHash;
+    if (hash.isEmpty()) {
+        return providerUrl(id);
+    }
+    return providerUrl(id) + QStringLiteral("?v=") + QString::fromLatin1(hash.left(8));
 }
 
 QString FaviconCache::extractHostname(const QString &serviceUrl) const
@@ -40,22 +849,15 @@ QString FaviconCache::extractHostname(const QString &serviceUrl) const
 
 QString FaviconCache::extractRootDomain(const QString &hostname) const
 {
-    // Handle cases like "web.whatsapp.com" -> "whatsapp.com"
-    // and "calendar.proton.me" -> "proton.me"
-    QStringList parts = hostname.split(QLatin1Char('.'));
-
-    if (parts.size() <= 2) {
-        return hostname; // Already a root domain or invalid
-    }
-
-    // For domains like "web.whatsapp.com", return "whatsapp.com"
-    // For domains like "calendar.proton.me", return "proton.me"
-    return parts.mid(parts.size() - 2).join(QLatin1Char('.'));
+    // "web.whatsapp.com" -> "whatsapp.com", "mail.example.co.uk" -> "example.co.uk".
+    // IP addresses and bare public suffixes are their own root.
+    const QString rootDomain = PublicSuffix::registrableDomain(hostname);
+    return rootDomain.isEmpty() ? hostname : rootDomain;
 }
 
 QString FaviconCache::getFaviconCachePath(const QString &hostname, FaviconSource source) const
 {
-    QString sourceDir = source == GoogleSource ? QStringLiteral("google") : QStringLiteral("iconhorse");
+    QString sourceDir = faviconId(QString(), source).chopped(1);
     return m_cacheDir + QStringLiteral("/favicons/") + sourceDir + QLatin1Char('/') + hashUrl(hostname) + QStringLiteral(".png");
 }
 
@@ -80,16 +882,35 @@ QString FaviconCache::getFavicon(const QString &serviceUrl, bool useFavicon)
         return QString();
     }
 
-    // Check Google favicon cache first
+    if (!m_indexReady) {
+        deferUntilIndexed(QStringLiteral("favicon|") + serviceUrl, [this, serviceUrl]() {
+            const QString localUrl = getFavicon(serviceUrl, true);
+            if (!localUrl.isEmpty()) {
+                Q_EMIT faviconReady(serviceUrl, localUrl);
+            }
+        });
+        return QString();
+    }
+
+    // The service's own icon, once one of its pages has been loaded
+    const QString pageCachePath = getFaviconCachePath(hostname, PageSource);
+    if (lookupOnDisk(pageCachePath, faviconId(hostname, PageSource), serviceUrl)) {
+        const QString localUrl = this->localUrl(pageCachePath, faviconId(hostname, PageSource));
+        m_faviconCache.insert(hostname, localUrl);
+        return localUrl;
+    }
+
+    // Then Google's
     QString googleCachePath = getFaviconCachePath(hostname, GoogleSource);
-    if (QFile::exists(googleCachePath)) {
-        QString localUrl = QStringLiteral("file://") + googleCachePath;
+    if (lookupOnDisk(googleCachePath, faviconId(hostname, GoogleSource), serviceUrl)) {
+        QString localUrl = this->localUrl(googleCachePath, faviconId(hostname, GoogleSource));
         m_faviconCache.insert(hostname, localUrl);
         m_googleFaviconCache.insert(hostname, localUrl);
         return localUrl;
     }
 
     // Start download with fallback
+    ++m_diskMisses;
     downloadFavicon(serviceUrl, hostname, GoogleWithFallback);
     return QString();
 }
@@ -107,15 +928,21 @@ QString FaviconCache::getFaviconForSource(const QString &serviceUrl, FaviconSour
 
     QString cachePath = getFaviconCachePath(hostname, source);
 
+    if (source == PageSource) {
+        return lookupOnDisk(cachePath, faviconId(hostname, source), serviceUrl) ? localUrl(cachePath, faviconId(hostname, source)) : QString();
+    }
+
     // Check memory cache
     QHash<QString, QString> &sourceCache = source == GoogleSource ? m_googleFaviconCache : m_iconHorseFaviconCache;
     if (sourceCache.contains(hostname)) {
+        lookupOnDisk(cachePath, faviconId(hostname, source), serviceUrl);
         return sourceCache.value(hostname);
     }
 
-    // Check disk cache
-    if (QFile::exists(cachePath)) {
-        QString localUrl = QStringLiteral("file://") + cachePath;
+    // Check disk cache (callers follow up with fetchFaviconFromSource, which
+    // is replayed once the index is ready)
+    if (lookupOnDisk(cachePath, faviconId(hostname, source), serviceUrl)) {
+        QString localUrl = this->localUrl(cachePath, faviconId(hostname, source));
         sourceCache.insert(hostname, localUrl);
         return localUrl;
     }
@@ -134,18 +961,31 @@ void FaviconCache::fetchFaviconFromSource(const QString &serviceUrl, FaviconSour
         return;
     }
 
+    // Page icons can't be fetched, only captured from a loaded page
+    if (source == PageSource) {
+        return;
+    }
+
+    if (!m_indexReady) {
+        deferUntilIndexed(QStringLiteral("source%1|").arg(static_cast<int>(source)) + serviceUrl, [this, serviceUrl, source]() {
+            fetchFaviconFromSource(serviceUrl, source);
+        });
+        return;
+    }
+
     QString cachePath = getFaviconCachePath(hostname, source);
 
     // Check if already cached
     QHash<QString, QString> &sourceCache = source == GoogleSource ? m_googleFaviconCache : m_iconHorseFaviconCache;
-    if (sourceCache.contains(hostname) || QFile::exists(cachePath)) {
-        QString localUrl = QStringLiteral("file://") + cachePath;
+    if (lookupOnDisk(cachePath, faviconId(hostname, source), serviceUrl)) {
+        QString localUrl = this->localUrl(cachePath, faviconId(hostname, source));
         sourceCache.insert(hostname, localUrl);
         Q_EMIT faviconSourceReady(serviceUrl, static_cast<int>(source), localUrl);
         return;
     }
 
     // Try subdomain first
+    ++m_diskMisses;
     FaviconFetchType fetchType = source == GoogleSource ? GoogleSubdomainOnly : IconHorseSubdomainOnly;
     downloadFavicon(serviceUrl, hostname, fetchType);
 }
@@ -163,165 +1003,266 @@ QString FaviconCache::getImageUrl(const QString &imageUrl)
     QString cachePath = getImageCachePath(imageUrl);
 
     if (m_imageCache.contains(imageUrl)) {
+        lookupOnDisk(cachePath, imageId(imageUrl), imageUrl);
         return m_imageCache.value(imageUrl);
     }
 
-    if (QFile::exists(cachePath)) {
-        m_imageCache.insert(imageUrl, QStringLiteral("file://") + cachePath);
+    if (!m_indexReady) {
+        deferUntilIndexed(QStringLiteral("image|") + imageUrl, [this, imageUrl]() {
+            const QString localUrl = getImageUrl(imageUrl);
+            if (!localUrl.isEmpty()) {
+                Q_EMIT imageReady(imageUrl, localUrl);
+            }
+        });
+        return QString();
+    }
+
+    if (lookupOnDisk(cachePath, imageId(imageUrl), imageUrl)) {
+        m_imageCache.insert(imageUrl, localUrl(cachePath, imageId(imageUrl)));
         return m_imageCache.value(imageUrl);
     }
 
+    ++m_diskMisses;
     downloadImage(imageUrl);
     return QString();
 }
 
-void FaviconCache::downloadFavicon(const QString &serviceUrl, const QString &hostname, FaviconFetchType fetchType)
+QString FaviconCache::faviconRequestUrl(const QString &hostname, FaviconFetchType fetchType) const
 {
-    // Create a unique key for tracking pending requests
-    QString fetchKeyString = hostname + QLatin1Char('_') + QString::number(static_cast<int>(fetchType));
-    if (m_pendingFavicons.contains(fetchKeyString)) {
-        return;
+    switch (fetchType) {
+    case GoogleWithFallback:
+    case GoogleSubdomainOnly:
+        return m_googleUrlTemplate.arg(hostname);
+    case GoogleRootDomainOnly:
+        return m_googleUrlTemplate.arg(extractRootDomain(hostname));
+    case IconHorseSubdomainOnly:
+        return m_iconHorseUrlTemplate.arg(hostname);
+    case IconHorseRootDomainOnly:
+        return m_iconHorseUrlTemplate.arg(extractRootDomain(hostname));
     }
+    return QString();
+}
 
-    m_pendingFavicons.insert(fetchKeyString);
-    m_fetchKeyToString.insert(fetchKeyString, fetchKeyString);
-
-    QString faviconUrl;
-
+void FaviconCache::fallBackToRootDomain(const QString &serviceUrl, const QString &hostname, FaviconFetchType fetchType)
+{
+    if (extractRootDomain(hostname) == hostname) {
+        return;
+    }
     switch (fetchType) {
     case GoogleWithFallback:
     case GoogleSubdomainOnly:
-        faviconUrl = QStringLiteral("https://www.google.com/s2/favicons?domain=%1&sz=128").arg(hostname);
-        break;
-    case GoogleRootDomainOnly: {
-        QString rootDomain = extractRootDomain(hostname);
-        faviconUrl = QStringLiteral("https://www.google.com/s2/favicons?domain=%1&sz=128").arg(rootDomain);
+        qDebug() << "Falling back from subdomain" << hostname << "to its root domain on Google";
+        downloadFavicon(serviceUrl, hostname, GoogleRootDomainOnly);
         break;
-    }
     case IconHorseSubdomainOnly:
-        faviconUrl = QStringLiteral("https://icon.horse/icon/%1").arg(hostname);
+        qDebug() << "Falling back from subdomain" << hostname << "to its root domain on icon.horse";
+        downloadFavicon(serviceUrl, hostname, IconHorseRootDomainOnly);
         break;
-    case IconHorseRootDomainOnly: {
-        QString rootDomain = extractRootDomain(hostname);
-        faviconUrl = QStringLiteral("https://icon.horse/icon/%1").arg(rootDomain);
+    case GoogleRootDomainOnly:
+    case IconHorseRootDomainOnly:
         break;
     }
+}
+
+void FaviconCache::downloadFavicon(const QString &serviceUrl, const QString &hostname, FaviconFetchType fetchType)
+{
+    // Create a unique key for tracking pending requests
+    QString fetchKeyString = hostname + QLatin1Char('_') + QString::number(static_cast<int>(fetchType));
+    if (m_pendingFavicons.contains(fetchKeyString)) {
+        return;
     }
 
-    QUrl url(faviconUrl);
-    QNetworkRequest request{url};
-    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
-    request.setRawHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:145.0) Gecko/20100101 Firefox/145.0");
+    const QString faviconUrl = faviconRequestUrl(hostname, fetchType);
 
-    QNetworkReply *reply = m_networkManager->get(request);
-    reply->setProperty("hostname", hostname);
-    reply->setProperty("serviceUrl", serviceUrl);
-    reply->setProperty("fetchType", static_cast<int>(fetchType));
-    reply->setProperty("fetchKeyString", fetchKeyString);
+    // Known dead: no request, no signal; the root domain fallback still applies
+    if (isBackedOff(faviconUrl)) {
+        fallBackToRootDomain(serviceUrl, hostname, fetchType);
+        return;
+    }
+
+    m_pendingFavicons.insert(fetchKeyString);
+    m_fetchKeyToString.insert(fetchKeyString, fetchKeyString);
 
-    connect(reply, &QNetworkReply::finished, this, &FaviconCache::onFaviconDownloaded);
+    DownloadJob job;
+    job.origin = serviceUrl;
+    job.hostname = hostname;
+    job.fetchType = fetchType;
+    job.fetchKeyString = fetchKeyString;
+    enqueueDownload(faviconUrl, job);
 }
 
 void FaviconCache::downloadImage(const QString &imageUrl)
 {
-    if (m_pendingImages.contains(imageUrl)) {
+    if (m_pendingImages.contains(imageUrl) || isBackedOff(imageUrl)) {
         return;
     }
 
     m_pendingImages.insert(imageUrl);
 
-    QUrl url(imageUrl);
-    QNetworkRequest request{url};
-    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
-    request.setRawHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:145.0) Gecko/20100101 Firefox/145.0");
-
-    QNetworkReply *reply = m_networkManager->get(request);
-    reply->setProperty("imageUrl", imageUrl);
+    DownloadJob job;
+    job.origin = imageUrl;
+    job.isImage = true;
+    enqueueDownload(imageUrl, job);
+}
 
-    connect(reply, &QNetworkReply::finished, this, &FaviconCache::onImageDownloaded);
+void FaviconCache::setPriorityOrigins(const QStringList &origins)
+{
+    m_priorityOrigins = QSet<QString>(origins.cbegin(), origins.cend());
 }
 
-void FaviconCache::onFaviconDownloaded()
+void FaviconCache::enqueueDownload(const QString &requestUrl, const DownloadJob &job)
 {
-    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
-    if (!reply) {
+    // Subdomains sharing a root domain, or the legacy and per-source lookups of
+    // one host, end up asking for the same URL: one request serves them all
+    auto it = m_downloadJobs.find(requestUrl);
+    if (it != m_downloadJobs.end()) {
+        it->append(job);
         return;
     }
+    m_downloadJobs.insert(requestUrl, {job});
+    m_downloadQueue.append(requestUrl);
+    startQueuedDownloads();
+}
 
-    QString hostname = reply->property("hostname").toString();
-    QString serviceUrl = reply->property("serviceUrl").toString();
-    int fetchTypeInt = reply->property("fetchType").toInt();
-    FaviconFetchType fetchType = static_cast<FaviconFetchType>(fetchTypeInt);
-    QString fetchKeyString = reply->property("fetchKeyString").toString();
+bool FaviconCache::isPriorityDownload(const QString &requestUrl) const
+{
+    const QList<DownloadJob> jobs = m_downloadJobs.value(requestUrl);
+    return std::any_of(jobs.cbegin(), jobs.cend(), [this](const DownloadJob &job) {
+        return m_priorityOrigins.contains(job.origin);
+    });
+}
 
-    m_pendingFavicons.remove(fetchKeyString);
-    m_fetchKeyToString.remove(fetchKeyString);
+void FaviconCache::startQueuedDownloads()
+{
+    while (m_activeDownloads < MAX_CONCURRENT_DOWNLOADS && !m_downloadQueue.isEmpty()) {
+        // Priority is decided at send time, so switching workspaces reorders
+        // whatever is still waiting
+        auto next = std::find_if(m_downloadQueue.begin(), m_downloadQueue.end(), [this](const QString &requestUrl) {
+            return isPriorityDownload(requestUrl);
+        });
+        if (next == m_downloadQueue.end()) {
+            next = m_downloadQueue.begin();
+        }
+        const QString requestUrl = *next;
+        m_downloadQueue.erase(next);
 
-    if (reply->error() == QNetworkReply::NoError) {
-        QByteArray data = reply->readAll();
-        if (!data.isEmpty()) {
-            // Determine the source based on fetch type
-            FaviconSource source =
-                (fetchType == GoogleSubdomainOnly || fetchType == GoogleRootDomainOnly || fetchType == GoogleWithFallback) ? GoogleSource : IconHorseSource;
-
-            QString cachePath = getFaviconCachePath(hostname, source);
-            QFile file(cachePath);
-            if (file.open(QIODevice::WriteOnly)) {
-                file.write(data);
-                file.close();
+        QUrl url(requestUrl);
+        QNetworkRequest request{url};
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+        request.setRawHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:145.0) Gecko/20100101 Firefox/145.0");
 
-                QString localUrl = QStringLiteral("file://") + cachePath;
+        QNetworkReply *reply = m_networkManager->get(request);
+        reply->setProperty("requestUrl", requestUrl);
+        ++m_activeDownloads;
 
-                // Update appropriate cache
-                if (source == GoogleSource) {
-                    m_googleFaviconCache.insert(hostname, localUrl);
-                } else {
-                    m_iconHorseFaviconCache.insert(hostname, localUrl);
-                }
-                m_faviconCache.insert(hostname, localUrl);
+        connect(reply, &QNetworkReply::finished, this, &FaviconCache::onDownloadFinished);
+    }
+}
 
-                // Emit both signals
-                Q_EMIT faviconReady(serviceUrl, localUrl);
-                Q_EMIT faviconSourceReady(serviceUrl, static_cast<int>(source), localUrl);
-            }
-        }
-    } else {
-        qWarning() << "Failed to download favicon for" << hostname << "from source" << fetchTypeInt << ":" << reply->errorString();
-
-        // If this was GoogleSubdomainOnly and it failed, try root domain
-        if (fetchType == GoogleSubdomainOnly) {
-            QString rootDomain = extractRootDomain(hostname);
-            if (rootDomain != hostname) {
-                qDebug() << "Falling back from subdomain" << hostname << "to root domain" << rootDomain;
-                downloadFavicon(serviceUrl, hostname, GoogleRootDomainOnly);
-            }
+void FaviconCache::onDownloadFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply) {
+        return;
+    }
+
+    --m_activeDownloads;
+    const QString requestUrl = reply->property("requestUrl").toString();
+    const QList<DownloadJob> jobs = m_downloadJobs.take(requestUrl);
+    QByteArray data = reply->error() == QNetworkReply::NoError ? reply->readAll() : QByteArray();
+    if (!data.isEmpty() && !isDecodableImage(data)) {
+        qWarning() << "Discarding undecodable image from" << requestUrl;
+        data.clear();
+    }
+    recordDownloadResult(requestUrl, !data.isEmpty());
+    for (const DownloadJob &job : jobs) {
+        if (job.isImage) {
+            finishImageDownload(job, reply, data);
+        } else {
+            finishFaviconDownload(job, reply, data);
         }
     }
 
     reply->deleteLater();
+    startQueuedDownloads();
 }
 
-void FaviconCache::onImageDownloaded()
+bool FaviconCache::isBackedOff(const QString &requestUrl) const
 {
-    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
-    if (!reply) {
+    auto it = m_failures.constFind(requestUrl);
+    return it != m_failures.cend() && it->retryAt > QDateTime::currentMSecsSinceEpoch();
+}
+
+void FaviconCache::recordDownloadResult(const QString &requestUrl, bool succeeded)
+{
+    if (succeeded) {
+        if (m_failures.remove(requestUrl)) {
+            m_indexDirty = true;
+        }
         return;
     }
 
-    QString imageUrl = reply->property("imageUrl").toString();
+    FailureEntry &failure = m_failures[requestUrl];
+    const qint64 backoff = qMin(FAILURE_BACKOFF_MS << qMin(failure.failures, 16), MAX_FAILURE_BACKOFF_MS);
+    ++failure.failures;
+    failure.retryAt = QDateTime::currentMSecsSinceEpoch() + backoff;
+    m_indexDirty = true;
+    scheduleMaintenance();
+}
+
+void FaviconCache::finishFaviconDownload(const DownloadJob &job, const QNetworkReply *reply, const QByteArray &data)
+{
+    const QString &hostname = job.hostname;
+    const QString &serviceUrl = job.origin;
+    const FaviconFetchType fetchType = job.fetchType;
+
+    m_pendingFavicons.remove(job.fetchKeyString);
+    m_fetchKeyToString.remove(job.fetchKeyString);
+
+    // Errors, timeouts and bodies that don't decode (data is empty then) all
+    // move on to the next step of the chain
+    if (data.isEmpty()) {
+        const QString reason = reply->error() != QNetworkReply::NoError ? reply->errorString() : QStringLiteral("no usable image");
+        qWarning() << "Failed to download favicon for" << hostname << "from source" << static_cast<int>(fetchType) << ":" << reason;
+        fallBackToRootDomain(serviceUrl, hostname, fetchType);
+        return;
+    }
+
+    // Determine the source based on fetch type
+    FaviconSource source =
+        (fetchType == GoogleSubdomainOnly || fetchType == GoogleRootDomainOnly || fetchType == GoogleWithFallback) ? GoogleSource : IconHorseSource;
+
+    QString cachePath = getFaviconCachePath(hostname, source);
+    const QString id = faviconId(hostname, source);
+    if (storeDownload(cachePath, id, data, reply)) {
+        QString localUrl = this->localUrl(cachePath, id);
+
+        // Update appropriate cache
+        if (source == GoogleSource) {
+            m_googleFaviconCache.insert(hostname, localUrl);
+        } else {
+            m_iconHorseFaviconCache.insert(hostname, localUrl);
+        }
+        m_faviconCache.insert(hostname, localUrl);
+
+        // Emit both signals
+        Q_EMIT faviconReady(serviceUrl, localUrl);
+        Q_EMIT faviconSourceReady(serviceUrl, static_cast<int>(source), localUrl);
+    }
+}
+
+void FaviconCache::finishImageDownload(const DownloadJob &job, const QNetworkReply *reply, const QByteArray &data)
+{
+    const QString &imageUrl = job.origin;
 
     m_pendingImages.remove(imageUrl);
 
     if (reply->error() == QNetworkReply::NoError) {
-        QByteArray data = reply->readAll();
         if (!data.isEmpty()) {
             QString cachePath = getImageCachePath(imageUrl);
-            QFile file(cachePath);
-            if (file.open(QIODevice::WriteOnly)) {
-                file.write(data);
-                file.close();
-
-                QString localUrl = QStringLiteral("file://") + cachePath;
+            const QString id = imageId(imageUrl);
+            if (storeDownload(cachePath, id, data, reply)) {
+                QString localUrl = this->localUrl(cachePath, id);
                 m_imageCache.insert(imageUrl, localUrl);
                 Q_EMIT imageReady(imageUrl, localUrl);
             }
@@ -329,8 +1270,6 @@ void FaviconCache::onImageDownloaded()
     } else {
         qWarning() << "Failed to download image" << imageUrl << ":" << reply->errorString();
     }
-
-    reply->deleteLater();
 }
 
 void FaviconCache::clearCache()
@@ -339,6 +1278,16 @@ void FaviconCache::clearCache()
     m_googleFaviconCache.clear();
     m_iconHorseFaviconCache.clear();
     m_imageCache.clear();
+    m_imageStore->clear();
+    m_diskIndex.clear();
+    m_revalidationQueue.clear();
+    m_revalidationOrigins.clear();
+    m_failures.clear();
+    m_blobRefs.clear();
+    m_prescaled.clear();
+    m_diskBytes = 0;
+    ++m_indexGeneration;
+    m_indexDirty = true;
 
     QDir faviconDir(m_cacheDir + QStringLiteral("/favicons"));
     faviconDir.removeRecursively();
@@ -346,7 +1295,9 @@ void FaviconCache::clearCache()
     QDir imageDir(m_cacheDir + QStringLiteral("/images"));
     imageDir.removeRecursively();
 
-    QDir().mkpath(m_cacheDir + QStringLiteral("/favicons/google"));
-    QDir().mkpath(m_cacheDir + QStringLiteral("/favicons/iconhorse"));
-    QDir().mkpath(m_cacheDir + QStringLiteral("/images"));
+    QDir blobDir(m_cacheDir + QStringLiteral("/blobs"));
+    blobDir.removeRecursively();
+
+    createCacheDirs(m_cacheDir);
+    runMaintenance();
 }
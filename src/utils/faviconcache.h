@@ -3,25 +3,39 @@
 
 #include <QDir>
 #include <QHash>
+#include <QImage>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QObject>
+#include <QPointer>
 #include <QSet>
+#include <QThreadPool>
 #include <QTimer>
 #include <QUrl>
+#include <QVariantMap>
+
+#include <functional>
+#include <memory>
+
+class FaviconImageProvider;
+class FaviconImageStore;
+class QQmlEngine;
 
 class FaviconCache : public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(QVariantMap cacheStats READ cacheStats NOTIFY cacheStatsChanged)
 
 public:
     enum FaviconSource {
         GoogleSource,
-        IconHorseSource
+        IconHorseSource,
+        PageSource // Declared by the service's own pages, see capturePageIcon()
     };
     Q_ENUM(FaviconSource)
 
     explicit FaviconCache(QObject *parent = nullptr);
+    ~FaviconCache() override;
 
     Q_INVOKABLE QString getFavicon(const QString &serviceUrl, bool useFavicon);
     Q_INVOKABLE QString getFaviconForSource(const QString &serviceUrl, FaviconSource source);
@@ -29,14 +43,51 @@ public:
     Q_INVOKABLE QString getImageUrl(const QString &imageUrl);
     Q_INVOKABLE void clearCache();
 
+    // Decoded-image cache behind image://serviceicon: hits, misses, entries, bytes
+    Q_INVOKABLE QVariantMap memoryCacheStats() const;
+
+    // Disk budget for cached favicons and service images. Past it, the least
+    // recently used files are deleted at the next maintenance run.
+    qint64 diskBudget() const;
+    void setDiskBudget(qint64 bytes);
+
+    // Disk cache entries, distinct blobs, bytes, budget, hits, misses, hitRate
+    // and backedOff (request URLs waiting out a failure), plus the memory cache
+    // figures prefixed with "memory"
+    QVariantMap cacheStats() const;
+
+    // Service and image URLs shown in the current workspace. Their downloads
+    // are sent ahead of everything else waiting in the queue.
+    void setPriorityOrigins(const QStringList &origins);
+
+    // Serves the image://serviceicon/<id> URLs handed to QML. The engine is
+    // also where QtWebEngine's image://favicon provider for page icons lives.
+    void registerImageProvider(QQmlEngine *engine);
+
+    // Stores the icon a service page declared (WebEngineView.icon) and prefers
+    // it over Google and icon.horse from then on. Icons of pages outside the
+    // service's domain, and ones too small to look right, are ignored.
+    Q_INVOKABLE void capturePageIcon(const QString &serviceUrl, const QUrl &pageUrl, const QUrl &iconUrl);
+
+    // Device pixel sizes (one per sidebar preset) and corner radius the sidebar
+    // requests icons at. Every icon handed out is decoded at each of them in the
+    // background, so switching presets or screens never scales on demand.
+    Q_INVOKABLE void setPrescaledVariants(const QVariantList &pixelSizes, int cornerRadius);
+
+    // Tests point the Google and icon.horse endpoints at a local server; the
+    // templates take the domain as %1
+    void setEndpointsForTesting(const QString &googleTemplate, const QString &iconHorseTemplate);
+    void setTransferTimeoutForTesting(int msecs);
+
 Q_SIGNALS:
     void faviconReady(const QString &serviceUrl, const QString &localPath);
     void faviconSourceReady(const QString &serviceUrl, int source, const QString &localPath);
     void imageReady(const QString &imageUrl, const QString &localPath);
+    void cacheStatsChanged();
 
 private Q_SLOTS:
-    void onFaviconDownloaded();
-    void onImageDownloaded();
+    void onDownloadFinished();
+    void onRevalidated();
 
 private:
     enum FaviconFetchType {
@@ -52,11 +103,88 @@ private:
     QString getImageCachePath(const QString &imageUrl) const;
     QString extractHostname(const QString &serviceUrl) const;
     QString extractRootDomain(const QString &hostname) const;
+    QString faviconRequestUrl(const QString &hostname, FaviconFetchType fetchType) const;
     void downloadFavicon(const QString &serviceUrl, const QString &hostname, FaviconFetchType fetchType);
+    // Next step of the chain once a subdomain lookup found nothing
+    void fallBackToRootDomain(const QString &serviceUrl, const QString &hostname, FaviconFetchType fetchType);
     void downloadImage(const QString &imageUrl);
+
+    // One consumer of a download; several may share a request URL
+    struct DownloadJob {
+        QString origin; // service URL, or the image URL itself
+        QString hostname;
+        FaviconFetchType fetchType = GoogleWithFallback;
+        QString fetchKeyString;
+        bool isImage = false;
+    };
+
+    void enqueueDownload(const QString &requestUrl, const DownloadJob &job);
+    bool isPriorityDownload(const QString &requestUrl) const;
+    void startQueuedDownloads();
+    void storePageIcon(const QString &serviceUrl, const QString &hostname, const QImage &image);
+    void prescale(const QString &id);
+    bool isBackedOff(const QString &requestUrl) const;
+    void recordDownloadResult(const QString &requestUrl, bool succeeded);
+    void finishFaviconDownload(const DownloadJob &job, const QNetworkReply *reply, const QByteArray &data);
+    void finishImageDownload(const DownloadJob &job, const QNetworkReply *reply, const QByteArray &data);
     QString hashUrl(const QString &url) const;
+    QString faviconId(const QString &hostname, FaviconSource source) const;
+    QString imageId(const QString &imageUrl) const;
+    QString providerUrl(const QString &id) const;
+    // providerUrl() plus a content version, so QML reloads after a refresh
+    QString localUrl(const QString &cachePath, const QString &id) const;
+
+    // One cached favicon or image, persisted in <cache dir>/index.json. The
+    // file at its path is a symlink into blobs/<contentHash>, shared by every
+    // entry with the same bytes. id is the image://serviceicon id, known once the
+    // file was written or looked up; url, etag and lastModified describe the
+    // download for revalidation.
+    struct DiskEntry {
+        QString id;
+        QString source;
+        QByteArray contentHash;
+        qint64 size = 0;
+        qint64 lastAccess = 0;
+        QString url;
+        QByteArray etag;
+        QByteArray lastModified;
+        qint64 fetchedAt = 0;
+    };
+
+    // A request URL that failed recently, skipped until retryAt
+    struct FailureEntry {
+        int failures = 0;
+        qint64 retryAt = 0;
+    };
+
+    struct IndexSnapshot {
+        QHash<QString, DiskEntry> entries;
+        QHash<QString, FailureEntry> failures;
+    };
+
+    static IndexSnapshot scanDisk(const QString &cacheDir);
+    void startIndexScan();
+    void onIndexScanned(const IndexSnapshot &snapshot, int generation);
+    // origin is the service or image URL the lookup was for; signals about a
+    // refreshed file are emitted for it
+    bool lookupOnDisk(const QString &cachePath, const QString &id, const QString &origin);
+    // Writes data (already validated) to its blob with QSaveFile and links
+    // cachePath to it; reply is null for icons that weren't downloaded
+    bool storeDownload(const QString &cachePath, const QString &id, const QByteArray &data, const QNetworkReply *reply);
+    void retainBlob(const QByteArray &hash, qint64 size);
+    // True when the last link went away and the blob can be deleted
+    bool releaseBlob(const QByteArray &hash, qint64 size);
+    void deferUntilIndexed(const QString &key, std::function<void()> lookup);
+    void scheduleMaintenance();
+    void runMaintenance();
+    void forgetCachedUrl(const QString &id);
+    QByteArray serializeIndex() const;
+    void queueRevalidation(const QString &cachePath, const QString &origin);
+    void revalidateNext();
 
     QNetworkAccessManager *m_networkManager;
+    QString m_googleUrlTemplate = QStringLiteral("https://www.google.com/s2/favicons?domain=%1&sz=128");
+    QString m_iconHorseUrlTemplate = QStringLiteral("https://icon.horse/icon/%1");
     QHash<QString, QString> m_faviconCache;
     QHash<QString, QString> m_googleFaviconCache;
     QHash<QString, QString> m_iconHorseFaviconCache;
@@ -64,7 +192,45 @@ private:
     QHash<QString, QString> m_fetchKeyToString;
     QSet<QString> m_pendingFavicons;
     QSet<QString> m_pendingImages;
+
+    QHash<QString, QList<DownloadJob>> m_downloadJobs; // request URL -> consumers, queued or in flight
+    QStringList m_downloadQueue; // request URLs not sent yet
+    int m_activeDownloads = 0;
+    QSet<QString> m_priorityOrigins;
+
+    // Negative cache, persisted with the index: failed request URLs back off
+    // exponentially instead of being retried on every lookup
+    QHash<QString, FailureEntry> m_failures;
     QString m_cacheDir;
+    std::shared_ptr<FaviconImageStore> m_imageStore;
+    QPointer<QQmlEngine> m_engine;
+    QList<int> m_variantSizes;
+    int m_variantRadius = 0;
+    QSet<QString> m_prescaled; // ids whose variants are decoded or being decoded
+
+    // Every cached file by path, filled by one background scan at startup and
+    // kept current on writes, so lookups never stat files on the GUI thread.
+    // Lookups arriving before the scan finishes are replayed once it does.
+    QHash<QString, DiskEntry> m_diskIndex;
+    bool m_indexReady = false;
+    int m_indexGeneration = 0;
+    QHash<QString, std::function<void()>> m_deferredLookups;
+    // Index scan and saves; waited for on destruction, as they post back to us
+    QThreadPool m_ioPool;
+
+    // Batches index saves, eviction and stats updates after bursts of activity
+    QTimer *m_maintenanceTimer;
+    bool m_indexDirty = false;
+    qint64 m_diskBudget;
+    QHash<QByteArray, int> m_blobRefs; // content hash -> links; m_diskBytes counts each blob once
+    qint64 m_diskBytes = 0;
+    qint64 m_diskHits = 0;
+    qint64 m_diskMisses = 0;
+
+    // Entries past their TTL, refreshed one at a time with conditional GETs
+    QTimer *m_revalidationTimer;
+    QStringList m_revalidationQueue;
+    QHash<QString, QString> m_revalidationOrigins; // cache path -> origin, queued or in flight
 };
 
 #endif // FAVICONCACHE_H
@@ -0,0 +1,125 @@
+#include "faviconimageprovider.h"
+
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QUrlQuery>
+
+namespace
+{
+QString cacheKey(const QString &id, const QSize &requestedSize, int cornerRadius)
+{
+    if (requestedSize.width() <= 0 && requestedSize.height() <= 0 && cornerRadius <= 0) {
+        return id;
+    }
+    QString key = id + QLatin1Char('@') + QString::number(requestedSize.width()) + QLatin1Char('x') + QString::number(requestedSize.height());
+    if (cornerRadius > 0) {
+        key += QLatin1Char('r') + QString::number(cornerRadius);
+    }
+    return key;
+}
+
+QImage roundCorners(const QImage &image, int radius)
+{
+    QImage rounded(image.size(), QImage::Format_ARGB32_Premultiplied);
+    rounded.fill(Qt::transparent);
+    QPainter painter(&rounded);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QBrush(image));
+    painter.drawRoundedRect(QRectF(rounded.rect()), radius, radius);
+    return rounded;
+}
+}
+
+FaviconImageStore::FaviconImageStore(PathResolver resolver, qint64 byteBudget)
+    : m_resolver(std::move(resolver))
+    , m_images(byteBudget)
+{
+}
+
+QImage FaviconImageStore::image(const QString &id, const QSize &requestedSize, int cornerRadius)
+{
+    const QString key = cacheKey(id, requestedSize, cornerRadius);
+    {
+        QMutexLocker locker(&m_mutex);
+        if (const QImage *cached = m_images.object(key)) {
+            ++m_hits;
+            return *cached;
+        }
+        ++m_misses;
+    }
+
+    // Decoded outside the lock so concurrent Images don't queue behind each other
+    const QString path = m_resolver(id);
+    if (path.isEmpty()) {
+        return QImage();
+    }
+    QImageReader reader(path);
+    const QSize original = reader.size();
+    if (original.isValid() && (requestedSize.width() > 0 || requestedSize.height() > 0)) {
+        const QSize bound(requestedSize.width() > 0 ? requestedSize.width() : original.width(),
+                          requestedSize.height() > 0 ? requestedSize.height() : original.height());
+        if (original.width() > bound.width() || original.height() > bound.height()) {
+            reader.setScaledSize(original.scaled(bound, Qt::KeepAspectRatio));
+        }
+    }
+    QImage image = reader.read();
+    if (image.isNull()) {
+        return image;
+    }
+    if (cornerRadius > 0) {
+        image = roundCorners(image, cornerRadius);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_images.insert(key, new QImage(image), image.sizeInBytes());
+    return image;
+}
+
+void FaviconImageStore::invalidate(const QString &id)
+{
+    const QString sizedPrefix = id + QLatin1Char('@');
+    QMutexLocker locker(&m_mutex);
+    const QList<QString> keys = m_images.keys();
+    for (const QString &key : keys) {
+        if (key == id || key.startsWith(sizedPrefix)) {
+            m_images.remove(key);
+        }
+    }
+}
+
+void FaviconImageStore::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_images.clear();
+}
+
+FaviconImageStore::Stats FaviconImageStore::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    Stats result;
+    result.hits = m_hits;
+    result.misses = m_misses;
+    result.entries = int(m_images.count());
+    result.bytes = m_images.totalCost();
+    return result;
+}
+
+FaviconImageProvider::FaviconImageProvider(std::shared_ptr<FaviconImageStore> store)
+    : QQuickImageProvider(QQuickImageProvider::Image)
+    , m_store(std::move(store))
+{
+}
+
+QImage FaviconImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    // "v" only exists to make QML reload a refreshed file
+    const QUrlQuery options(id.section(QLatin1Char('?'), 1));
+    const int cornerRadius = options.queryItemValue(QStringLiteral("r")).toInt();
+    const QImage image = m_store->image(id.section(QLatin1Char('?'), 0, 0), requestedSize, cornerRadius);
+    if (size) {
+        *size = image.size();
+    }
+    return image;
+}
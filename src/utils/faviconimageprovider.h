@@ -0,0 +1,61 @@
+#ifndef FAVICONIMAGEPROVIDER_H
+#define FAVICONIMAGEPROVIDER_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QQuickImageProvider>
+
+#include <functional>
+#include <memory>
+
+// Decoded favicons and service images shared by every QML Image. Keyed by
+// provider id plus requested size and corner radius, capped by decoded bytes,
+// least recently used entries dropped first. Thread-safe: asynchronous Images
+// load from a pool.
+class FaviconImageStore
+{
+public:
+    // Maps a provider id ("google/<host>", "iconhorse/<host>", "image/<file>")
+    // to the file on disk, or an empty string if unknown
+    using PathResolver = std::function<QString(const QString &id)>;
+
+    struct Stats {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        int entries = 0;
+        qint64 bytes = 0;
+    };
+
+    FaviconImageStore(PathResolver resolver, qint64 byteBudget);
+
+    // cornerRadius > 0 bakes rounded, antialiased corners into the image so
+    // QML can draw it without a mask effect
+    QImage image(const QString &id, const QSize &requestedSize, int cornerRadius = 0);
+    // Drops every cached size of id, e.g. after the file was rewritten
+    void invalidate(const QString &id);
+    void clear();
+    Stats stats() const;
+
+private:
+    PathResolver m_resolver;
+    mutable QMutex m_mutex;
+    QCache<QString, QImage> m_images;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+};
+
+// image://serviceicon/<id>[?v=<version>][&r=<corner radius>] front end for
+// FaviconImageStore (owned by the QML engine)
+class FaviconImageProvider : public QQuickImageProvider
+{
+public:
+    explicit FaviconImageProvider(std::shared_ptr<FaviconImageStore> store);
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+private:
+    std::shared_ptr<FaviconImageStore> m_store;
+};
+
+#endif // FAVICONIMAGEPROVIDER_H
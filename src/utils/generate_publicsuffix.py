@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2025 Denys Madureira
+# SPDX-License-Identifier: GPL-3.0-or-later
+#
+# Compiles public_suffix_list.dat into the constexpr trie PublicSuffix looks
+# hosts up in (see publicsuffix.cpp). Run by CMake at build time:
+#
+#   generate_publicsuffix.py <public_suffix_list.dat> <output header>
+#
+# The trie is keyed by labels from the TLD down. Each node's children are
+# stored contiguously, sorted bytewise, so they can be binary searched.
+# Wildcard rules ("*.ck") become a flag on their parent node and exception
+# rules ("!www.ck") a flag on the excepted node. IDN labels are stored
+# punycoded, the form QUrl::toAce() produces.
+
+import sys
+
+RULE = 1
+EXCEPTION = 2
+WILDCARD_CHILDREN = 4
+
+
+def to_ace(label):
+    if label.isascii():
+        return label
+    return "xn--" + label.encode("punycode").decode("ascii")
+
+
+def read_rules(path):
+    rules = []
+    with open(path, encoding="utf-8") as source:
+        for line in source:
+            # Rules end at the first whitespace; everything else is comments
+            rule = line.split(maxsplit=1)[0] if line.strip() else ""
+            if not rule or rule.startswith("//"):
+                continue
+            rules.append(rule.lower())
+    return rules
+
+
+class Node:
+    def __init__(self):
+        self.children = {}
+        self.flags = 0
+
+
+def build_trie(rules):
+    root = Node()
+    for rule in rules:
+        flag = RULE
+        if rule.startswith("!"):
+            flag = EXCEPTION
+            rule = rule[1:]
+        labels = [to_ace(label) for label in reversed(rule.split("."))]
+        if labels[-1] == "*":
+            labels.pop()
+            flag = WILDCARD_CHILDREN
+        node = root
+        for label in labels:
+            if "*" in label:
+                sys.exit("unsupported wildcard position in rule: " + rule)
+            node = node.children.setdefault(label, Node())
+        node.flags |= flag
+    return root
+
+
+def layout(root):
+    # Breadth first, so every node's children end up next to each other
+    nodes = [("", root)]
+    firsts = []
+    index = 0
+    while index < len(nodes):
+        _, node = nodes[index]
+        firsts.append(len(nodes))
+        nodes.extend(sorted(node.children.items(), key=lambda item: item[0].encode("ascii")))
+        index += 1
+    return nodes, firsts
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: generate_publicsuffix.py <public_suffix_list.dat> <output header>")
+
+    rules = read_rules(sys.argv[1])
+    nodes, firsts = layout(build_trie(rules))
+
+    label_offsets = {}
+    label_blob = ""
+    for label, _ in nodes:
+        if label not in label_offsets:
+            label_offsets[label] = len(label_blob)
+            label_blob += label
+
+    out = []
+    out.append("// Generated by generate_publicsuffix.py from public_suffix_list.dat, do not edit.")
+    out.append("// %d rules, %d nodes, %d label bytes" % (len(rules), len(nodes), len(label_blob)))
+    out.append("")
+    out.append("#ifndef PUBLICSUFFIXDATA_H")
+    out.append("#define PUBLICSUFFIXDATA_H")
+    out.append("")
+    out.append("#include <cstdint>")
+    out.append("")
+    out.append("namespace PublicSuffixData")
+    out.append("{")
+    out.append("enum NodeFlag : std::uint8_t {")
+    out.append("    Rule = %d," % RULE)
+    out.append("    Exception = %d," % EXCEPTION)
+    out.append("    WildcardChildren = %d," % WILDCARD_CHILDREN)
+    out.append("};")
+    out.append("")
+    out.append("struct Node {")
+    out.append("    std::uint32_t label; // offset into labels")
+    out.append("    std::uint8_t labelLength;")
+    out.append("    std::uint8_t flags;")
+    out.append("    std::uint16_t childCount;")
+    out.append("    std::uint32_t firstChild;")
+    out.append("};")
+    out.append("")
+    out.append("constexpr char labels[] =")
+    for start in range(0, len(label_blob), 96):
+        out.append('    "%s"' % label_blob[start:start + 96])
+    out.append("    ;")
+    out.append("")
+    out.append("constexpr Node nodes[] = {")
+    for index, (label, node) in enumerate(nodes):
+        if len(label) > 255 or len(node.children) > 65535:
+            sys.exit("label or child count out of range: " + label)
+        out.append("    {%d, %d, %d, %d, %d}," % (label_offsets[label], len(label), node.flags, len(node.children), firsts[index]))
+    out.append("};")
+    out.append("}")
+    out.append("")
+    out.append("#endif // PUBLICSUFFIXDATA_H")
+
+    with open(sys.argv[2], "w", encoding="ascii") as header:
+        header.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
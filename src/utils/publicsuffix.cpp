@@ -0,0 +1,154 @@
+#include "publicsuffix.h"
+#include "publicsuffixdata.h"
+
+#include <QUrl>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+using PublicSuffixData::Node;
+
+int compareLabel(const Node &node, const char *label, int length)
+{
+    const int common = std::min(int(node.labelLength), length);
+    const int result = std::memcmp(PublicSuffixData::labels + node.label, label, size_t(common));
+    return result != 0 ? result : int(node.labelLength) - length;
+}
+
+const Node *findChild(const Node &parent, const char *label, int length)
+{
+    int low = 0;
+    int high = int(parent.childCount) - 1;
+    while (low <= high) {
+        const int middle = (low + high) / 2;
+        const Node &child = PublicSuffixData::nodes[parent.firstChild + middle];
+        const int order = compareLabel(child, label, length);
+        if (order == 0) {
+            return &child;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return nullptr;
+}
+
+// A host parsed for lookup: lowercase, punycoded, no trailing dot
+struct Host {
+    QString text; // as passed in, lowercased
+    QByteArray ace;
+    int labelCount = 0;
+};
+
+Host parseHost(const QString &host)
+{
+    Host parsed;
+    parsed.text = host.toLower();
+    if (parsed.text.endsWith(QLatin1Char('.'))) {
+        parsed.text.chop(1);
+    }
+
+    bool ascii = true;
+    for (const QChar c : std::as_const(parsed.text)) {
+        if (c.unicode() >= 0x80) {
+            ascii = false;
+            break;
+        }
+    }
+    parsed.ace = ascii ? parsed.text.toLatin1() : QUrl::toAce(parsed.text);
+
+    // Bracketed or bare IPv6 literals contain colons, IPv4 ones end in digits
+    const QByteArray &ace = parsed.ace;
+    if (ace.isEmpty() || ace.contains(':') || (ace.back() >= '0' && ace.back() <= '9')) {
+        return Host();
+    }
+
+    int labels = 1;
+    for (qsizetype i = 0; i < ace.size(); ++i) {
+        if (ace.at(i) != '.') {
+            continue;
+        }
+        // Empty labels: leading dot or ".."
+        if (i == 0 || ace.at(i - 1) == '.') {
+            return Host();
+        }
+        ++labels;
+    }
+    parsed.labelCount = labels;
+    return parsed;
+}
+
+// How many trailing labels of host form its public suffix
+int suffixLabels(const Host &host)
+{
+    const QByteArray &ace = host.ace;
+    const Node *node = &PublicSuffixData::nodes[0];
+    // No rule matching is the same as a "*" rule: the TLD is the suffix
+    int suffix = 1;
+    int depth = 0;
+    qsizetype end = ace.size();
+    while (node && end > 0) {
+        const qsizetype start = ace.lastIndexOf('.', end - 1) + 1;
+        const Node *child = findChild(*node, ace.constData() + start, int(end - start));
+        if (child && (child->flags & PublicSuffixData::Exception)) {
+            // "!www.ck": the rule minus its leftmost label
+            return depth;
+        }
+        if ((child && (child->flags & PublicSuffixData::Rule)) || (node->flags & PublicSuffixData::WildcardChildren)) {
+            suffix = depth + 1;
+        }
+        node = child;
+        ++depth;
+        end = start - 1;
+    }
+    return suffix;
+}
+
+QString trailingLabels(const QString &host, int count)
+{
+    qsizetype start = host.size();
+    for (int i = 0; i < count; ++i) {
+        start = host.lastIndexOf(QLatin1Char('.'), start - 1);
+        if (start < 0) {
+            return host;
+        }
+    }
+    return host.mid(start + 1);
+}
+}
+
+namespace PublicSuffix
+{
+QString publicSuffix(const QString &host)
+{
+    const Host parsed = parseHost(host);
+    if (parsed.labelCount == 0) {
+        return QString();
+    }
+    return trailingLabels(parsed.text, suffixLabels(parsed));
+}
+
+QString registrableDomain(const QString &host)
+{
+    const Host parsed = parseHost(host);
+    if (parsed.labelCount == 0) {
+        return QString();
+    }
+    const int labels = suffixLabels(parsed) + 1;
+    if (labels > parsed.labelCount) {
+        return QString();
+    }
+    return trailingLabels(parsed.text, labels);
+}
+
+bool isSameSite(const QString &host, const QString &otherHost)
+{
+    const QString site = registrableDomain(host);
+    return !site.isEmpty() && site == registrableDomain(otherHost);
+}
+}
@@ -0,0 +1,26 @@
+#ifndef PUBLICSUFFIX_H
+#define PUBLICSUFFIX_H
+
+#include <QString>
+
+// Lookups in the public suffix list (publicsuffix.org), compiled into a trie
+// at build time by generate_publicsuffix.py. Each lookup is one pass over the
+// host's labels. Hosts are matched case-insensitively and IDNs in either
+// Unicode or punycode form; results keep the form of the host passed in.
+namespace PublicSuffix
+{
+// "co.uk" for "mail.example.co.uk". Hosts on unlisted TLDs fall back to their
+// last label. Empty for IP addresses and malformed hosts.
+QString publicSuffix(const QString &host);
+
+// The public suffix plus one label ("example.co.uk" for "mail.example.co.uk"),
+// i.e. what the host's owner registered. Empty when host is a public suffix
+// itself, an IP address or malformed.
+QString registrableDomain(const QString &host);
+
+// True when both hosts share a registrable domain: "mail.google.com" and
+// "calendar.google.com", but not "alice.github.io" and "bob.github.io"
+bool isSameSite(const QString &host, const QString &otherHost);
+}
+
+#endif // PUBLICSUFFIX_H
@@ -1,4 +1,5 @@
 #include "widevinemanager.h"
+#include "crx3payloaddevice.h"
 
 #include <KLocalizedString>
 #include <KZip>
@@ -13,12 +14,193 @@
 #include <QProcess>
 #include <QSaveFile>
 #include <QStandardPaths>
+#include <QTimer>
+#include <QVersionNumber>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+
+namespace
+{
+// Read size per readyRead pass and cap on what the reply buffers meanwhile
+constexpr qint64 DOWNLOAD_CHUNK_SIZE = 256 * 1024;
+
+// Attempts per install before giving up, backing off 1, 2, 4... seconds
+constexpr int MAX_DOWNLOAD_ATTEMPTS = 6;
+constexpr int RETRY_BASE_DELAY_MS = 1000;
+// A connection silent this long is dropped and resumed
+constexpr int DOWNLOAD_STALL_TIMEOUT_MS = 60000;
+
+// "bytes 1000-1999/5000"; total is -1 for "*"
+bool parseContentRange(const QByteArray &value, qint64 *start, qint64 *total)
+{
+    if (!value.startsWith("bytes ")) {
+        return false;
+    }
+    const qsizetype dash = value.indexOf('-');
+    const qsizetype slash = value.indexOf('/');
+    if (dash < 0 || slash < dash) {
+        return false;
+    }
+    bool ok = false;
+    *start = value.mid(6, dash - 6).trimmed().toLongLong(&ok);
+    if (!ok) {
+        return false;
+    }
+    const QByteArray length = value.mid(slash + 1).trimmed();
+    *total = length == "*" ? -1 : length.toLongLong();
+    return true;
+}
+
+// Background update checks: well after startup, then daily
+constexpr auto UPDATE_CHECK_DELAY = std::chrono::minutes(5);
+constexpr auto UPDATE_CHECK_INTERVAL = std::chrono::hours(24);
+
+// Links inside WidevineCdm/ to one of its version directories. Chromium is
+// pointed at "current", which only moves at startup, before it loads the
+// library; a finished update waits behind "pending" until then.
+const QString CURRENT_LINK = QStringLiteral("current");
+const QString PENDING_LINK = QStringLiteral("pending");
+// Holds the version last rolled back from. Background checks skip it and
+// anything older; installing by hand clears it.
+const QString ROLLED_BACK_FILE = QStringLiteral("rolled-back");
+
+QString libraryPath(const QString &versionDir)
+{
+    return versionDir + QStringLiteral("/_platform_specific/linux_x64/libwidevinecdm.so");
+}
+
+// Version directories look like "4.10.2830.0"
+bool isVersionName(const QString &name)
+{
+    return name.contains(QLatin1Char('.')) && name.at(0).isDigit();
+}
+
+// The version a link points at, if it still has a library
+QString linkedVersion(const QString &root, const QString &link)
+{
+    const QFileInfo info(root + QLatin1Char('/') + link);
+    if (!info.isSymLink()) {
+        return QString();
+    }
+    const QString version = QFileInfo(info.symLinkTarget()).fileName();
+    return isVersionName(version) && QFile::exists(libraryPath(root + QLatin1Char('/') + version)) ? version : QString();
+}
+
+QString rolledBackVersion(const QString &root)
+{
+    QFile file(root + QLatin1Char('/') + ROLLED_BACK_FILE);
+    return file.open(QIODevice::ReadOnly) ? QString::fromLatin1(file.readAll().trimmed()) : QString();
+}
+
+// Complete version directories, newest first
+QStringList installedVersions(const QString &root)
+{
+    QStringList versions;
+    const QStringList entries = QDir(root).entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+    for (const QString &entry : entries) {
+        if (isVersionName(entry) && QFile::exists(libraryPath(root + QLatin1Char('/') + entry))) {
+            versions.append(entry);
+        }
+    }
+    std::sort(versions.begin(), versions.end(), [](const QString &a, const QString &b) {
+        return QVersionNumber::fromString(a) > QVersionNumber::fromString(b);
+    });
+    return versions;
+}
+
+// Repoints root/link at a version directory in one rename, so readers see
+// either the old target or the new one
+bool pointLink(const QString &root, const QString &link, const QString &version)
+{
+    const QByteArray linkPath = QFile::encodeName(root + QLatin1Char('/') + link);
+    const QByteArray temporary = linkPath + ".new";
+    ::unlink(temporary.constData());
+    if (::symlink(QFile::encodeName(version).constData(), temporary.constData()) != 0) {
+        return false;
+    }
+    if (std::rename(temporary.constData(), linkPath.constData()) != 0) {
+        ::unlink(temporary.constData());
+        return false;
+    }
+    return true;
+}
+
+// Mozilla's "hashFunction" names
+bool hashAlgorithmFromName(const QString &name, QCryptographicHash::Algorithm *algorithm)
+{
+    if (name == QLatin1String("sha512")) {
+        *algorithm = QCryptographicHash::Sha512;
+    } else if (name == QLatin1String("sha384")) {
+        *algorithm = QCryptographicHash::Sha384;
+    } else if (name == QLatin1String("sha256")) {
+        *algorithm = QCryptographicHash::Sha256;
+    } else {
+        return false;
+    }
+    return true;
+}
+}
 
 WidevineManager::WidevineManager(QObject *parent)
     : QObject(parent)
     , m_networkManager(new QNetworkAccessManager(this))
+    , m_installCancelled(std::make_shared<std::atomic_bool>(false))
 {
+    // One install at a time; its stages run in order
+    m_installPool.setMaxThreadCount(1);
     checkInstallation();
+
+    m_updateTimer.setTimerType(Qt::VeryCoarseTimer);
+    m_updateTimer.setInterval(UPDATE_CHECK_INTERVAL);
+    connect(&m_updateTimer, &QTimer::timeout, this, &WidevineManager::checkForUpdates);
+    m_updateTimer.start();
+    QTimer::singleShot(UPDATE_CHECK_DELAY, Qt::VeryCoarseTimer, this, &WidevineManager::checkForUpdates);
+}
+
+QString WidevineManager::prepareForStartup()
+{
+    const QString root = getWidevinePath();
+    const QString current = linkedVersion(root, CURRENT_LINK);
+    const QString pending = linkedVersion(root, PENDING_LINK);
+
+    // Nothing has loaded the library yet, so this is the moment to switch
+    if (!pending.isEmpty() && pending != current) {
+        if (pointLink(root, CURRENT_LINK, pending)) {
+            qDebug() << "Switched Widevine from" << current << "to" << pending;
+            // The one switched away from stays for rollback
+            const QStringList versions = installedVersions(root);
+            for (const QString &version : versions) {
+                if (version != pending && version != current) {
+                    QDir(root + QLatin1Char('/') + version).removeRecursively();
+                }
+            }
+            QFile::remove(root + QLatin1Char('/') + PENDING_LINK);
+        }
+    } else {
+        QFile::remove(root + QLatin1Char('/') + PENDING_LINK);
+    }
+
+    if (linkedVersion(root, CURRENT_LINK).isEmpty()) {
+        // Installs from before there was a link, or a link left dangling
+        const QStringList versions = installedVersions(root);
+        if (versions.isEmpty() || !pointLink(root, CURRENT_LINK, versions.first())) {
+            return QString();
+        }
+    }
+    return libraryPath(root + QLatin1Char('/') + CURRENT_LINK);
+}
+
+WidevineManager::~WidevineManager()
+{
+    // Anything the worker already queued for us is dropped with this object
+    m_installCancelled->store(true);
+    m_installPool.waitForDone();
 }
 
 bool WidevineManager::isInstalled() const
@@ -46,47 +228,48 @@ int WidevineManager::downloadProgress() const
     return m_downloadProgress;
 }
 
+WidevineManager::InstallStage WidevineManager::installStage() const
+{
+    return m_installStage;
+}
+
+bool WidevineManager::isDownloading() const
+{
+    return m_installStage == Downloading;
+}
+
 bool WidevineManager::isRunningInFlatpak() const
 {
     return QFile::exists(QStringLiteral("/.flatpak-info")) || !qEnvironmentVariableIsEmpty("FLATPAK_ID");
 }
 
-QString WidevineManager::getPluginsPath() const
+QString WidevineManager::pendingVersion() const
+{
+    return m_pendingVersion;
+}
+
+QString WidevineManager::previousVersion() const
+{
+    return m_previousVersion;
+}
+
+QString WidevineManager::getPluginsPath()
 {
     // Widevine is installed at ~/.var/app/io.github.denysmb.unify/plugins
     const QString homePath = QDir::homePath();
     return homePath + QStringLiteral("/.var/app/io.github.denysmb.unify/plugins");
 }
 
-QString WidevineManager::getWidevinePath() const
+QString WidevineManager::getWidevinePath()
 {
     return getPluginsPath() + QStringLiteral("/WidevineCdm");
 }
 
 QString WidevineManager::findInstalledVersion() const
 {
-    const QString widevinePath = getWidevinePath();
-    QDir widevineDir(widevinePath);
-
-    if (!widevineDir.exists()) {
-        return QString();
-    }
-
-    // Look for version directories (e.g., 4.10.2830.0)
-    const QStringList entries = widevineDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    for (const QString &entry : entries) {
-        // Check if this looks like a version number (contains dots and numbers)
-        if (entry.contains(QLatin1Char('.')) && !entry.isEmpty() && entry.at(0).isDigit()) {
-            // Verify the library exists in this version
-            const QString libPath =
-                widevinePath + QLatin1Char('/') + entry + QStringLiteral("/_platform_specific/linux_x64/libwidevinecdm.so");
-            if (QFile::exists(libPath)) {
-                return entry;
-            }
-        }
-    }
-
-    return QString();
+    const QString root = getWidevinePath();
+    const QString current = linkedVersion(root, CURRENT_LINK);
+    return current.isEmpty() ? installedVersions(root).value(0) : current;
 }
 
 void WidevineManager::checkInstallation()
@@ -104,6 +287,29 @@ void WidevineManager::checkInstallation()
     if (oldVersion != m_installedVersion) {
         Q_EMIT installedVersionChanged();
     }
+
+    const QString root = getWidevinePath();
+    QString pending = linkedVersion(root, PENDING_LINK);
+    if (pending == version) {
+        pending.clear();
+    }
+    if (m_pendingVersion != pending) {
+        m_pendingVersion = pending;
+        Q_EMIT pendingVersionChanged();
+    }
+
+    QString previous;
+    const QStringList versions = installedVersions(root);
+    for (const QString &candidate : versions) {
+        if (candidate != version) {
+            previous = candidate;
+            break;
+        }
+    }
+    if (m_previousVersion != previous) {
+        m_previousVersion = previous;
+        Q_EMIT previousVersionChanged();
+    }
 }
 
 void WidevineManager::setStatusMessage(const QString &message)
@@ -122,6 +328,38 @@ void WidevineManager::setDownloadProgress(int progress)
     }
 }
 
+void WidevineManager::setInstallStage(InstallStage stage)
+{
+    if (m_installStage != stage) {
+        m_installStage = stage;
+        Q_EMIT installStageChanged();
+    }
+
+    switch (stage) {
+    case Idle:
+        setStatusMessage(QString());
+        break;
+    case FetchingMetadata:
+        setStatusMessage(i18n("Fetching Widevine metadata..."));
+        break;
+    case Downloading:
+        setStatusMessage(i18n("Downloading Widevine CDM %1...", m_widevineVersion));
+        break;
+    case Verifying:
+        setStatusMessage(i18n("Verifying Widevine CDM..."));
+        break;
+    case Extracting:
+        setStatusMessage(i18n("Extracting Widevine CDM..."));
+        break;
+    case Installing:
+        setStatusMessage(i18n("Installing Widevine files..."));
+        break;
+    case Configuring:
+        setStatusMessage(i18n("Configuring Flatpak environment..."));
+        break;
+    }
+}
+
 void WidevineManager::install()
 {
     if (m_isInstalling) {
@@ -133,7 +371,58 @@ void WidevineManager::install()
     Q_EMIT isInstallingChanged();
     Q_EMIT installationStarted();
 
-    setStatusMessage(i18n("Fetching Widevine metadata..."));
+    // Asked for by hand: whatever is newest, even a version rolled back from
+    QFile::remove(getWidevinePath() + QLatin1Char('/') + ROLLED_BACK_FILE);
+
+    // An update already on its way becomes this install
+    if (m_backgroundUpdate) {
+        m_backgroundUpdate = false;
+        return;
+    }
+    startInstall();
+}
+
+void WidevineManager::checkForUpdates()
+{
+    if (m_isInstalling || m_backgroundUpdate || !m_isInstalled) {
+        return;
+    }
+
+    qDebug() << "Checking for Widevine updates";
+    m_backgroundUpdate = true;
+    startInstall();
+}
+
+void WidevineManager::rollback()
+{
+    if (m_isInstalling || m_backgroundUpdate || m_previousVersion.isEmpty()) {
+        return;
+    }
+
+    const QString root = getWidevinePath();
+    if (!pointLink(root, PENDING_LINK, m_previousVersion)) {
+        return;
+    }
+
+    // Otherwise the next background check would bring the newer one back
+    const QString rolledBackFile = root + QLatin1Char('/') + ROLLED_BACK_FILE;
+    if (QVersionNumber::fromString(m_previousVersion) < QVersionNumber::fromString(m_installedVersion)) {
+        QSaveFile file(rolledBackFile);
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(m_installedVersion.toLatin1());
+            file.commit();
+        }
+    } else {
+        QFile::remove(rolledBackFile);
+    }
+    checkInstallation();
+}
+
+void WidevineManager::startInstall()
+{
+    m_installCancelled = std::make_shared<std::atomic_bool>(false);
+
+    setInstallStage(FetchingMetadata);
     setDownloadProgress(0);
 
     // Create temporary directory for downloads
@@ -143,9 +432,17 @@ void WidevineManager::install()
         return;
     }
 
-    // Step 1: Download metadata JSON from Firefox repository
+    // Step 1: Download metadata JSON from Firefox repository, unless the
+    // copy from last time is still current
     QNetworkRequest request(QUrl(QString::fromLatin1(FIREFOX_WIDEVINE_JSON)));
     request.setHeader(QNetworkRequest::UserAgentHeader, QStringLiteral("Mozilla/5.0"));
+    QFile etagFile(metadataCachePath() + QStringLiteral(".etag"));
+    if (QFile::exists(metadataCachePath()) && etagFile.open(QIODevice::ReadOnly)) {
+        request.setRawHeader("If-None-Match", etagFile.readAll().trimmed());
+    }
+    if (m_backgroundUpdate) {
+        request.setPriority(QNetworkRequest::LowPriority);
+    }
 
     m_currentReply = m_networkManager->get(request);
     connect(m_currentReply, &QNetworkReply::finished, this, &WidevineManager::onMetadataReceived);
@@ -164,15 +461,26 @@ void WidevineManager::onMetadataReceived()
         return; // Error handled by onNetworkError
     }
 
-    const QByteArray data = m_currentReply->readAll();
+    QByteArray data = m_currentReply->readAll();
+    const int status = m_currentReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const QByteArray etag = m_currentReply->rawHeader("ETag");
     m_currentReply->deleteLater();
     m_currentReply = nullptr;
 
+    if (status == 304) {
+        QFile cached(metadataCachePath());
+        data = cached.open(QIODevice::ReadOnly) ? cached.readAll() : QByteArray();
+    } else {
+        saveMetadataCache(data, etag);
+    }
+
     // Parse JSON
     QJsonParseError parseError;
     const QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
 
     if (parseError.error != QJsonParseError::NoError) {
+        // Don't keep revalidating a bad copy
+        QFile::remove(metadataCachePath() + QStringLiteral(".etag"));
         finishInstallation(false, i18n("Failed to parse Widevine metadata: %1", parseError.errorString()));
         return;
     }
@@ -192,106 +500,431 @@ void WidevineManager::onMetadataReceived()
     const QJsonObject linuxPlatform = platforms[QStringLiteral("Linux_x86_64-gcc3")].toObject();
 
     m_widevineUrl = linuxPlatform[QStringLiteral("fileUrl")].toString();
-    m_widevineHash = linuxPlatform[QStringLiteral("hashValue")].toString();
+    m_widevineHash = linuxPlatform[QStringLiteral("hashValue")].toString().toLower();
 
     if (m_widevineUrl.isEmpty() || m_widevineVersion.isEmpty()) {
         finishInstallation(false, i18n("Failed to extract Widevine download information"));
         return;
     }
 
+    // Nothing gets installed that can't be checked against the metadata
+    const QString hashFunction = root[QStringLiteral("hashFunction")].toString(QStringLiteral("sha512"));
+    if (m_widevineHash.isEmpty() || !hashAlgorithmFromName(hashFunction, &m_widevineHashAlgorithm)) {
+        finishInstallation(false, i18n("Widevine metadata has no usable checksum"));
+        return;
+    }
+
     qDebug() << "Widevine version:" << m_widevineVersion;
     qDebug() << "Widevine URL:" << m_widevineUrl;
 
-    // Check if already installed
-    const QString installDir = getWidevinePath() + QLatin1Char('/') + m_widevineVersion;
-    const QString libPath = installDir + QStringLiteral("/_platform_specific/linux_x64/libwidevinecdm.so");
+    const QString root = getWidevinePath();
+    if (m_backgroundUpdate
+        && (QVersionNumber::fromString(m_widevineVersion) <= QVersionNumber::fromString(m_installedVersion) || m_widevineVersion == m_pendingVersion)) {
+        finishInstallation(true, QStringLiteral("Widevine %1 is up to date").arg(m_installedVersion));
+        return;
+    }
+    const QString rolledBack = rolledBackVersion(root);
+    if (m_backgroundUpdate && !rolledBack.isEmpty() && QVersionNumber::fromString(m_widevineVersion) <= QVersionNumber::fromString(rolledBack)) {
+        finishInstallation(true, QStringLiteral("Widevine %1 was rolled back from, skipping it").arg(m_widevineVersion));
+        return;
+    }
 
-    if (QFile::exists(libPath)) {
+    // Check if already installed
+    if (m_widevineVersion == linkedVersion(root, CURRENT_LINK)) {
         finishInstallation(true, i18n("Widevine %1 is already installed.", m_widevineVersion));
         return;
     }
+    // Kept from before a rollback: no need to download it again
+    if (QFile::exists(libraryPath(root + QLatin1Char('/') + m_widevineVersion))) {
+        if (!pointLink(root, linkedVersion(root, CURRENT_LINK).isEmpty() ? CURRENT_LINK : PENDING_LINK, m_widevineVersion)) {
+            finishInstallation(false, i18n("Failed to install Widevine files"));
+            return;
+        }
+        finishInstallation(true, i18n("Widevine %1 installed successfully! Please restart Unify to enable DRM content playback.", m_widevineVersion));
+        return;
+    }
+
+    // Step 2: Download the .crx3 file, straight to disk, resuming whatever an
+    // earlier attempt left behind
+    setInstallStage(Downloading);
+
+    m_downloadSize = linuxPlatform[QStringLiteral("filesize")].toInteger(-1);
+    m_downloadAttempts = 0;
+    if (!openPartialDownload()) {
+        finishInstallation(false, i18n("Failed to save downloaded file"));
+        return;
+    }
+    startCdmDownload();
+}
+
+QString WidevineManager::partialDownloadPath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/widevine/widevinecdm-") + m_widevineVersion
+        + QStringLiteral(".crx3.part");
+}
+
+bool WidevineManager::openPartialDownload()
+{
+    const QString path = partialDownloadPath();
+    if (!QDir().mkpath(QFileInfo(path).path())) {
+        return false;
+    }
+
+    // Only bytes fetched from the same URL, for the same checksum, are resumed
+    QJsonObject state;
+    QFile stateFile(path + QStringLiteral(".json"));
+    if (stateFile.open(QIODevice::ReadOnly)) {
+        state = QJsonDocument::fromJson(stateFile.readAll()).object();
+    }
+    const bool sameDownload =
+        state[QStringLiteral("url")].toString() == m_widevineUrl && state[QStringLiteral("hash")].toString() == m_widevineHash;
+    m_downloadETag = sameDownload ? state[QStringLiteral("etag")].toString() : QString();
+    if (m_downloadSize <= 0 && sameDownload) {
+        m_downloadSize = state[QStringLiteral("size")].toInteger(-1);
+    }
+
+    m_crxFile = new QFile(path);
+    if (!m_crxFile->open(sameDownload ? QIODevice::ReadWrite : QIODevice::ReadWrite | QIODevice::Truncate)) {
+        qWarning() << "Failed to open" << path << m_crxFile->errorString();
+        return false;
+    }
+
+    // The digest can't be persisted, so it is caught up from what's on disk
+    m_crxHash = std::make_unique<QCryptographicHash>(m_widevineHashAlgorithm);
+    if (!m_crxHash->addData(m_crxFile)) {
+        restartPartialDownload();
+    }
+    if (m_crxFile->size() > 0) {
+        qDebug() << "Resuming Widevine download at" << m_crxFile->size() << "bytes";
+    }
+    saveDownloadState();
+    return true;
+}
+
+void WidevineManager::saveDownloadState()
+{
+    QSaveFile stateFile(partialDownloadPath() + QStringLiteral(".json"));
+    if (!stateFile.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    const QJsonObject state{{QStringLiteral("url"), m_widevineUrl},
+                            {QStringLiteral("hash"), m_widevineHash},
+                            {QStringLiteral("etag"), m_downloadETag},
+                            {QStringLiteral("size"), m_downloadSize}};
+    stateFile.write(QJsonDocument(state).toJson(QJsonDocument::Compact));
+    stateFile.commit();
+}
 
-    // Step 2: Download the .crx3 file
-    setStatusMessage(i18n("Downloading Widevine CDM %1...", m_widevineVersion));
+void WidevineManager::restartPartialDownload()
+{
+    m_crxFile->resize(0);
+    m_crxFile->seek(0);
+    m_crxHash->reset();
+    m_resumeOffset = 0;
+}
+
+void WidevineManager::discardPartialDownload()
+{
+    delete m_crxFile;
+    m_crxFile = nullptr;
+    m_crxHash.reset();
+
+    const QString path = partialDownloadPath();
+    QFile::remove(path);
+    QFile::remove(path + QStringLiteral(".json"));
+}
+
+void WidevineManager::startCdmDownload()
+{
+    ++m_downloadAttempts;
+    m_acceptingBody = false;
+    m_downloadWriteFailed = false;
+
+    // A range without a validator could splice two different files together,
+    // unless the size alone tells them apart
+    m_resumeOffset = m_crxFile->size();
+    if (m_resumeOffset > 0 && m_downloadETag.isEmpty() && m_downloadSize <= 0) {
+        restartPartialDownload();
+    }
+    m_crxFile->seek(m_resumeOffset);
 
     QNetworkRequest downloadRequest{QUrl(m_widevineUrl)};
     downloadRequest.setHeader(QNetworkRequest::UserAgentHeader, QStringLiteral("Mozilla/5.0"));
+    downloadRequest.setTransferTimeout(DOWNLOAD_STALL_TIMEOUT_MS);
+    if (m_backgroundUpdate) {
+        downloadRequest.setPriority(QNetworkRequest::LowPriority);
+    }
+    if (m_resumeOffset > 0) {
+        downloadRequest.setRawHeader("Range", "bytes=" + QByteArray::number(m_resumeOffset) + '-');
+        if (!m_downloadETag.isEmpty()) {
+            // Changed file: the server answers 200 with all of it instead
+            downloadRequest.setRawHeader("If-Range", m_downloadETag.toLatin1());
+        }
+    }
 
     m_currentReply = m_networkManager->get(downloadRequest);
+    m_currentReply->setReadBufferSize(DOWNLOAD_CHUNK_SIZE);
+    connect(m_currentReply, &QNetworkReply::metaDataChanged, this, &WidevineManager::onDownloadMetaDataChanged);
+    connect(m_currentReply, &QNetworkReply::readyRead, this, &WidevineManager::onDownloadReadyRead);
     connect(m_currentReply, &QNetworkReply::downloadProgress, this, &WidevineManager::onDownloadProgress);
     connect(m_currentReply, &QNetworkReply::finished, this, &WidevineManager::onDownloadFinished);
-    connect(m_currentReply, &QNetworkReply::errorOccurred, this, &WidevineManager::onNetworkError);
+}
+
+void WidevineManager::onDownloadMetaDataChanged()
+{
+    if (!m_currentReply || !m_crxFile) {
+        return;
+    }
+
+    const int status = m_currentReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 206) {
+        qint64 start = -1;
+        qint64 total = -1;
+        parseContentRange(m_currentReply->rawHeader("Content-Range"), &start, &total);
+        if (start != m_resumeOffset || (m_downloadSize > 0 && total != m_downloadSize)) {
+            qWarning() << "Widevine server resumed at an unexpected range:" << m_currentReply->rawHeader("Content-Range");
+            restartPartialDownload();
+            m_downloadETag.clear();
+            m_currentReply->abort();
+            return;
+        }
+        if (m_downloadSize <= 0) {
+            m_downloadSize = total;
+        }
+    } else if (status == 200) {
+        // Range ignored, or the file changed since: this is all of it, from the start
+        if (m_resumeOffset > 0) {
+            qDebug() << "Widevine download restarts from the beginning";
+            restartPartialDownload();
+        }
+        if (m_downloadSize <= 0) {
+            m_downloadSize = m_currentReply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+        }
+    } else {
+        return;
+    }
+
+    const QByteArray etag = m_currentReply->rawHeader("ETag");
+    // Weak validators aren't allowed in If-Range
+    m_downloadETag = etag.startsWith("W/") ? QString() : QString::fromLatin1(etag);
+    saveDownloadState();
+    m_acceptingBody = true;
 }
 
 void WidevineManager::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
 {
-    if (bytesTotal > 0) {
-        setDownloadProgress(static_cast<int>((bytesReceived * 100) / bytesTotal));
+    // Relative to the whole file, across resumes
+    const qint64 total = m_downloadSize > 0 ? m_downloadSize : (bytesTotal > 0 ? m_resumeOffset + bytesTotal : 0);
+    if (total > 0) {
+        setDownloadProgress(static_cast<int>(std::min<qint64>(100, ((m_resumeOffset + bytesReceived) * 100) / total)));
     }
 }
 
-void WidevineManager::onDownloadFinished()
+void WidevineManager::onDownloadReadyRead()
 {
-    if (!m_currentReply || !m_tempDir) {
+    // Error pages and discarded ranges never reach the file
+    if (!m_currentReply || !m_crxFile || !m_crxHash || !m_acceptingBody || m_downloadWriteFailed) {
         return;
     }
 
-    if (m_currentReply->error() != QNetworkReply::NoError) {
-        m_currentReply->deleteLater();
-        m_currentReply = nullptr;
-        return; // Error handled by onNetworkError
+    QByteArray chunk(DOWNLOAD_CHUNK_SIZE, Qt::Uninitialized);
+    for (;;) {
+        const qint64 read = m_currentReply->read(chunk.data(), chunk.size());
+        if (read <= 0) {
+            break;
+        }
+        m_crxHash->addData(QByteArrayView(chunk.constData(), read));
+        if (m_crxFile->write(chunk.constData(), read) != read) {
+            qWarning() << "Failed to write Widevine download:" << m_crxFile->errorString();
+            m_downloadWriteFailed = true;
+            m_currentReply->abort();
+            break;
+        }
     }
+}
 
-    setStatusMessage(i18n("Extracting Widevine CDM..."));
-    setDownloadProgress(100);
+void WidevineManager::onDownloadFinished()
+{
+    if (!m_currentReply || !m_tempDir || !m_crxFile) {
+        return;
+    }
 
-    // Save downloaded file
-    const QString crxPath = m_tempDir->path() + QStringLiteral("/widevine.crx3");
-    QSaveFile crxFile(crxPath);
+    // Whatever arrived after the last readyRead
+    onDownloadReadyRead();
+    const QNetworkReply::NetworkError error = m_currentReply->error();
+    const QString errorString = m_currentReply->errorString();
+    const int status = m_currentReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    m_currentReply->deleteLater();
+    m_currentReply = nullptr;
+    m_crxFile->flush();
 
-    if (!crxFile.open(QIODevice::WriteOnly)) {
-        m_currentReply->deleteLater();
-        m_currentReply = nullptr;
+    if (m_downloadWriteFailed) {
         finishInstallation(false, i18n("Failed to save downloaded file"));
         return;
     }
 
-    crxFile.write(m_currentReply->readAll());
+    // 416: the previous attempt already had every byte
+    const bool complete = m_downloadSize > 0 && m_crxFile->size() == m_downloadSize;
+    if (error != QNetworkReply::NoError && !(status == 416 && complete)) {
+        if (status == 416) {
+            restartPartialDownload();
+        }
+        retryDownload(status, errorString);
+        return;
+    }
+    if (m_downloadSize > 0 && !complete) {
+        retryDownload(status, i18n("Connection closed before the download completed"));
+        return;
+    }
 
-    if (!crxFile.commit()) {
-        m_currentReply->deleteLater();
-        m_currentReply = nullptr;
-        finishInstallation(false, i18n("Failed to save downloaded file"));
+    setInstallStage(Verifying);
+    setDownloadProgress(100);
+
+    const QString digest = QString::fromLatin1(m_crxHash->result().toHex());
+    if (digest != m_widevineHash) {
+        qWarning() << "Widevine checksum mismatch, expected" << m_widevineHash << "got" << digest;
+        discardPartialDownload();
+        finishInstallation(false, i18n("The downloaded Widevine CDM is corrupt (checksum mismatch)"));
         return;
     }
 
-    m_currentReply->deleteLater();
-    m_currentReply = nullptr;
+    const QString crxPath = m_crxFile->fileName();
+    m_crxFile->close();
 
-    // Step 3: Extract the .crx3 file
+    // Steps 3-5 (extract, install, configure) run off the GUI thread
+    runInstallPipeline(crxPath);
+}
+
+void WidevineManager::runInstallPipeline(const QString &crxPath)
+{
     const QString extractDir = m_tempDir->path() + QStringLiteral("/extracted");
-    QDir().mkpath(extractDir);
+    const QString root = getWidevinePath();
+    // A first install is used right away, an update from the next start
+    const QString link = linkedVersion(root, CURRENT_LINK).isEmpty() ? CURRENT_LINK : PENDING_LINK;
+    const std::shared_ptr<std::atomic_bool> cancelled = m_installCancelled;
+
+    setInstallStage(Extracting);
+    m_installPool.start([this, crxPath, extractDir, root, link, version = m_widevineVersion, cancelled]() {
+        const InstallResult result = runInstallStages(crxPath, extractDir, root, version, link, *cancelled);
+        QMetaObject::invokeMethod(
+            this,
+            [this, result]() {
+                onInstallPipelineFinished(result);
+            },
+            Qt::QueuedConnection);
+    });
+}
 
-    if (!extractCrx3(crxPath, extractDir)) {
-        finishInstallation(false, i18n("Failed to extract Widevine CDM archive"));
-        return;
+// Worker thread: only touches its arguments and the const helpers
+WidevineManager::InstallResult
+WidevineManager::runInstallStages(const QString &crxPath,
+                                  const QString &extractDir,
+                                  const QString &root,
+                                  const QString &version,
+                                  const QString &link,
+                                  const std::atomic_bool &cancelled)
+{
+    const QString installDir = root + QLatin1Char('/') + version;
+    const auto reportStage = [this](InstallStage stage) {
+        QMetaObject::invokeMethod(
+            this,
+            [this, stage]() {
+                setInstallStage(stage);
+            },
+            Qt::QueuedConnection);
+    };
+
+    InstallResult result;
+
+    // Step 3: Extract the .crx3 file
+    QDir().mkpath(extractDir);
+    if (!extractCrx3(crxPath, extractDir, cancelled) || cancelled) {
+        result.failedStage = Extracting;
+        result.cancelled = cancelled;
+        // A verified download is worth keeping for the next attempt
+        result.keepDownload = result.cancelled;
+        return result;
     }
 
     // Step 4: Install files to destination
-    setStatusMessage(i18n("Installing Widevine files..."));
+    reportStage(Installing);
+    if (!copyWidevineFiles(extractDir, installDir) || cancelled || !pointLink(root, link, version)) {
+        // Nothing half-copied is left to look like an installed version
+        QDir(installDir).removeRecursively();
+        result.failedStage = Installing;
+        result.cancelled = cancelled;
+        return result;
+    }
+
+    // Step 5: Configure Flatpak environment (if running in Flatpak); too
+    // late to cancel, the files are in place
+    if (isRunningInFlatpak()) {
+        reportStage(Configuring);
+        // Through the link, so the override survives updates
+        configureEnvironment(libraryPath(root + QLatin1Char('/') + CURRENT_LINK));
+    } else {
+        qDebug() << "Not running in Flatpak, skipping environment configuration";
+    }
 
-    const QString installDir = getWidevinePath() + QLatin1Char('/') + m_widevineVersion;
+    return result;
+}
 
-    if (!copyWidevineFiles(extractDir, installDir)) {
+void WidevineManager::onInstallPipelineFinished(const InstallResult &result)
+{
+    if (!result.keepDownload) {
+        discardPartialDownload();
+    }
+
+    if (result.cancelled) {
+        Q_EMIT installationCancelled();
+        finishInstallation(false, i18n("Widevine installation cancelled"));
+    } else if (result.failedStage == Extracting) {
+        finishInstallation(false, i18n("Failed to extract Widevine CDM archive"));
+    } else if (result.failedStage == Installing) {
         finishInstallation(false, i18n("Failed to install Widevine files"));
+    } else {
+        finishInstallation(true, i18n("Widevine %1 installed successfully! Please restart Unify to enable DRM content playback.", m_widevineVersion));
+    }
+}
+
+void WidevineManager::cancelInstallation()
+{
+    if (!m_isInstalling) {
         return;
     }
 
-    // Step 5: Configure Flatpak environment (if running in Flatpak)
-    const QString libPath = installDir + QStringLiteral("/_platform_specific/linux_x64/libwidevinecdm.so");
-    configureEnvironment(libPath);
+    m_installCancelled->store(true);
+    if (m_installStage >= Extracting) {
+        // The worker stops at the next file or stage and reports back
+        setStatusMessage(i18n("Cancelling..."));
+        return;
+    }
 
-    finishInstallation(true, i18n("Widevine %1 installed successfully! Please restart Unify to enable DRM content playback.", m_widevineVersion));
+    // Metadata, download or a pending retry: all on this thread
+    Q_EMIT installationCancelled();
+    finishInstallation(false, i18n("Widevine installation cancelled"));
+}
+
+void WidevineManager::retryDownload(int httpStatus, const QString &reason)
+{
+    // Client errors other than timeouts, throttling and bad ranges won't go away
+    const bool permanent = httpStatus >= 400 && httpStatus < 500 && httpStatus != 408 && httpStatus != 416 && httpStatus != 429;
+    if (permanent || m_downloadAttempts >= MAX_DOWNLOAD_ATTEMPTS) {
+        finishInstallation(false, i18n("Network error: %1", reason));
+        return;
+    }
+
+    const int delayMs = RETRY_BASE_DELAY_MS << (m_downloadAttempts - 1);
+    qWarning() << "Widevine download interrupted:" << reason << "- retrying in" << delayMs << "ms";
+    setStatusMessage(i18np("Download interrupted, resuming in 1 second...", "Download interrupted, resuming in %1 seconds...", delayMs / 1000));
+    QTimer::singleShot(delayMs, this, [this, cancelled = m_installCancelled]() {
+        // Cancelled or finished in the meantime
+        if (*cancelled || !m_crxFile || m_currentReply) {
+            return;
+        }
+        setInstallStage(Downloading);
+        startCdmDownload();
+    });
 }
 
 void WidevineManager::onNetworkError(QNetworkReply::NetworkError error)
@@ -308,45 +941,18 @@ void WidevineManager::onNetworkError(QNetworkReply::NetworkError error)
     finishInstallation(false, i18n("Network error: %1", errorMsg));
 }
 
-bool WidevineManager::extractCrx3(const QString &crxPath, const QString &destDir)
+bool WidevineManager::extractCrx3(const QString &crxPath, const QString &destDir, const std::atomic_bool &cancelled) const
 {
-    // CRX3 files are ZIP archives with a header
-    // We need to find where the ZIP data starts
-
-    QFile crxFile(crxPath);
-    if (!crxFile.open(QIODevice::ReadOnly)) {
-        qWarning() << "Failed to open CRX3 file";
+    // The ZIP is read in place, behind the CRX3 header
+    Crx3PayloadDevice payload(crxPath);
+    if (!payload.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to read CRX3 file:" << payload.errorString();
         return false;
     }
 
-    QByteArray data = crxFile.readAll();
-    crxFile.close();
-
-    // Find the ZIP signature (PK\x03\x04)
-    const QByteArray zipSignature = QByteArray::fromHex("504B0304");
-    int zipStart = data.indexOf(zipSignature);
+    qDebug() << "ZIP data starts at offset:" << payload.payloadOffset();
 
-    if (zipStart < 0) {
-        qWarning() << "Could not find ZIP signature in CRX3 file";
-        return false;
-    }
-
-    qDebug() << "ZIP data starts at offset:" << zipStart;
-
-    // Write the ZIP portion to a temporary file
-    const QString zipPath = m_tempDir->path() + QStringLiteral("/widevine.zip");
-    QFile zipFile(zipPath);
-
-    if (!zipFile.open(QIODevice::WriteOnly)) {
-        qWarning() << "Failed to create temporary ZIP file";
-        return false;
-    }
-
-    zipFile.write(data.mid(zipStart));
-    zipFile.close();
-
-    // Extract using KZip
-    KZip zip(zipPath);
+    KZip zip(&payload);
     if (!zip.open(QIODevice::ReadOnly)) {
         qWarning() << "Failed to open ZIP archive";
         return false;
@@ -359,8 +965,27 @@ bool WidevineManager::extractCrx3(const QString &crxPath, const QString &destDir
         return false;
     }
 
-    // Extract all files
-    root->copyTo(destDir);
+    // Only what copyWidevineFiles installs
+    const QStringList wanted{QStringLiteral("_platform_specific/linux_x64/libwidevinecdm.so"),
+                             QStringLiteral("manifest.json"),
+                             QStringLiteral("LICENSE"),
+                             QStringLiteral("LICENSE.txt")};
+    for (const QString &path : wanted) {
+        if (cancelled) {
+            zip.close();
+            return false;
+        }
+        const KArchiveFile *file = root->file(path);
+        if (!file) {
+            continue;
+        }
+        const QString targetDir = QDir(destDir).filePath(QFileInfo(path).path());
+        if (!QDir().mkpath(targetDir) || !file->copyTo(targetDir)) {
+            qWarning() << "Failed to extract" << path;
+            zip.close();
+            return false;
+        }
+    }
     zip.close();
 
     // Verify extraction
@@ -378,7 +1003,7 @@ bool WidevineManager::extractCrx3(const QString &crxPath, const QString &destDir
     return true;
 }
 
-bool WidevineManager::copyWidevineFiles(const QString &extractDir, const QString &installDir)
+bool WidevineManager::copyWidevineFiles(const QString &extractDir, const QString &installDir) const
 {
     const QString libDir = installDir + QStringLiteral("/_platform_specific/linux_x64");
 
@@ -427,15 +1052,8 @@ bool WidevineManager::copyWidevineFiles(const QString &extractDir, const QString
     return true;
 }
 
-void WidevineManager::configureEnvironment(const QString &libPath)
+void WidevineManager::configureEnvironment(const QString &libPath) const
 {
-    if (!isRunningInFlatpak()) {
-        qDebug() << "Not running in Flatpak, skipping environment configuration";
-        return;
-    }
-
-    setStatusMessage(i18n("Configuring Flatpak environment..."));
-
     // Build Chromium flags
     QStringList flags;
     flags << QStringLiteral("--autoplay-policy=no-user-gesture-required");
@@ -468,8 +1086,19 @@ void WidevineManager::configureEnvironment(const QString &libPath)
 
 void WidevineManager::finishInstallation(bool success, const QString &message)
 {
-    m_isInstalling = false;
-    Q_EMIT isInstallingChanged();
+    const bool background = std::exchange(m_backgroundUpdate, false);
+    if (!background) {
+        m_isInstalling = false;
+        Q_EMIT isInstallingChanged();
+    }
+
+    // Stops a retry that is still scheduled
+    m_installCancelled->store(true);
+
+    // What was downloaded so far stays on disk for the next attempt
+    delete m_crxFile;
+    m_crxFile = nullptr;
+    m_crxHash.reset();
 
     if (m_tempDir) {
         delete m_tempDir;
@@ -477,18 +1106,47 @@ void WidevineManager::finishInstallation(bool success, const QString &message)
     }
 
     if (m_currentReply) {
+        // Without its finished() coming back here
+        m_currentReply->disconnect(this);
+        m_currentReply->abort();
         m_currentReply->deleteLater();
         m_currentReply = nullptr;
     }
 
-    setStatusMessage(QString());
+    setInstallStage(Idle);
     setDownloadProgress(0);
 
     checkInstallation();
 
+    if (background) {
+        qDebug() << "Widevine update check finished:" << success << message;
+        return;
+    }
     Q_EMIT installationFinished(success, message);
 }
 
+QString WidevineManager::metadataCachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/widevine/widevinecdm.json");
+}
+
+void WidevineManager::saveMetadataCache(const QByteArray &data, const QByteArray &etag)
+{
+    const QString path = metadataCachePath();
+    QDir().mkpath(QFileInfo(path).path());
+    QFile::remove(path + QStringLiteral(".etag"));
+
+    QSaveFile metadata(path);
+    if (!metadata.open(QIODevice::WriteOnly) || metadata.write(data) != data.size() || !metadata.commit() || etag.isEmpty()) {
+        return;
+    }
+    QSaveFile etagFile(path + QStringLiteral(".etag"));
+    if (etagFile.open(QIODevice::WriteOnly)) {
+        etagFile.write(etag);
+        etagFile.commit();
+    }
+}
+
 void WidevineManager::uninstall()
 {
     if (m_isInstalling) {
@@ -496,6 +1154,17 @@ void WidevineManager::uninstall()
         return;
     }
 
+    // A background update would put back what is removed here. Until its
+    // files are being written it lives on this thread and simply stops;
+    // after that the worker can't be stopped short of linking them in.
+    if (m_backgroundUpdate) {
+        if (m_installStage >= Extracting) {
+            Q_EMIT uninstallationFinished(false, i18n("A Widevine update is being installed. Please try again in a moment."));
+            return;
+        }
+        finishInstallation(false, QStringLiteral("Widevine update check cancelled by uninstall"));
+    }
+
     const QString widevinePath = getWidevinePath();
 
     // Remove Widevine files
@@ -1,10 +1,18 @@
 #pragma once
 
+#include <QCryptographicHash>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QObject>
 #include <QString>
 #include <QTemporaryDir>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <atomic>
+#include <memory>
+
+class QFile;
 
 class WidevineManager : public QObject
 {
@@ -14,18 +22,56 @@ class WidevineManager : public QObject
     Q_PROPERTY(QString installedVersion READ installedVersion NOTIFY installedVersionChanged)
     Q_PROPERTY(QString statusMessage READ statusMessage NOTIFY statusMessageChanged)
     Q_PROPERTY(int downloadProgress READ downloadProgress NOTIFY downloadProgressChanged)
+    Q_PROPERTY(InstallStage installStage READ installStage NOTIFY installStageChanged)
+    // installStage == Downloading, the only stage with a known size
+    Q_PROPERTY(bool downloading READ isDownloading NOTIFY installStageChanged)
+    // Installed and switched to on the next start, by an update or rollback
+    Q_PROPERTY(QString pendingVersion READ pendingVersion NOTIFY pendingVersionChanged)
+    // Kept on disk, so rollback() needs no download
+    Q_PROPERTY(QString previousVersion READ previousVersion NOTIFY previousVersionChanged)
 
 public:
+    // Extracting and later run on a worker thread
+    enum InstallStage {
+        Idle,
+        FetchingMetadata,
+        Downloading,
+        Verifying,
+        Extracting,
+        Installing,
+        Configuring,
+    };
+    Q_ENUM(InstallStage)
+
     explicit WidevineManager(QObject *parent = nullptr);
+    ~WidevineManager() override;
+
+    // Called before Chromium starts: switches to a pending version, if any,
+    // and returns the library path to hand it, empty when not installed
+    static QString prepareForStartup();
 
     bool isInstalled() const;
     bool isInstalling() const;
     QString installedVersion() const;
     QString statusMessage() const;
     int downloadProgress() const;
+    InstallStage installStage() const;
+    bool isDownloading() const;
+    QString pendingVersion() const;
+    QString previousVersion() const;
 
     Q_INVOKABLE void checkInstallation();
     Q_INVOKABLE void install();
+    // Takes effect between files or stages; the Flatpak configuration step
+    // runs to completion
+    Q_INVOKABLE void cancelInstallation();
+    // Also runs on its own shortly after startup and then daily. A newer
+    // CDM is downloaded and installed quietly, and becomes pendingVersion
+    Q_INVOKABLE void checkForUpdates();
+    // Switches to previousVersion on the next start. Rolling back from a
+    // version keeps background checks from reinstalling it; only a newer one
+    // or an install() by hand replaces it.
+    Q_INVOKABLE void rollback();
     Q_INVOKABLE void uninstall();
 
 Q_SIGNALS:
@@ -34,42 +80,99 @@ Q_SIGNALS:
     void installedVersionChanged();
     void statusMessageChanged();
     void downloadProgressChanged();
+    void installStageChanged();
+    void pendingVersionChanged();
+    void previousVersionChanged();
     void installationStarted();
     void installationFinished(bool success, const QString &message);
     void uninstallationFinished(bool success, const QString &message);
+    // Followed by installationFinished(false, ...)
+    void installationCancelled();
 
 private Q_SLOTS:
     void onMetadataReceived();
+    void onDownloadMetaDataChanged();
     void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void onDownloadReadyRead();
     void onDownloadFinished();
     void onNetworkError(QNetworkReply::NetworkError error);
 
 private:
-    QString getPluginsPath() const;
-    QString getWidevinePath() const;
+    // What the worker hands back; Idle when every stage succeeded
+    struct InstallResult {
+        InstallStage failedStage = Idle;
+        bool cancelled = false;
+        bool keepDownload = false;
+    };
+
+    static QString getPluginsPath();
+    static QString getWidevinePath();
+    static QString metadataCachePath();
+    void saveMetadataCache(const QByteArray &data, const QByteArray &etag);
+    void startInstall();
     QString findInstalledVersion() const;
-    bool extractCrx3(const QString &crxPath, const QString &destDir);
-    bool copyWidevineFiles(const QString &extractDir, const QString &installDir);
+    QString partialDownloadPath() const;
+    bool openPartialDownload();
+    void saveDownloadState();
+    void restartPartialDownload();
+    void discardPartialDownload();
+    void startCdmDownload();
+    void retryDownload(int httpStatus, const QString &reason);
+    void runInstallPipeline(const QString &crxPath);
+    InstallResult runInstallStages(const QString &crxPath,
+                                   const QString &extractDir,
+                                   const QString &root,
+                                   const QString &version,
+                                   const QString &link,
+                                   const std::atomic_bool &cancelled);
+    void onInstallPipelineFinished(const InstallResult &result);
+    bool extractCrx3(const QString &crxPath, const QString &destDir, const std::atomic_bool &cancelled) const;
+    bool copyWidevineFiles(const QString &extractDir, const QString &installDir) const;
     void setStatusMessage(const QString &message);
     void setDownloadProgress(int progress);
+    void setInstallStage(InstallStage stage);
     void finishInstallation(bool success, const QString &message);
-    void configureEnvironment(const QString &libPath);
+    void configureEnvironment(const QString &libPath) const;
     bool isRunningInFlatpak() const;
 
     QNetworkAccessManager *m_networkManager = nullptr;
     QNetworkReply *m_currentReply = nullptr;
     QTemporaryDir *m_tempDir = nullptr;
 
+    // The CRX is streamed to a .part file in the cache and hashed as it
+    // arrives; interrupted downloads resume from there with a Range request
+    QFile *m_crxFile = nullptr;
+    std::unique_ptr<QCryptographicHash> m_crxHash;
+    QString m_downloadETag;
+    qint64 m_downloadSize = -1;
+    qint64 m_resumeOffset = 0; // bytes on disk when the current request started
+    int m_downloadAttempts = 0;
+    bool m_acceptingBody = false;
+    bool m_downloadWriteFailed = false;
+
     bool m_isInstalled = false;
     bool m_isInstalling = false;
     QString m_installedVersion;
     QString m_statusMessage;
     int m_downloadProgress = 0;
+    InstallStage m_installStage = Idle;
+    QString m_pendingVersion;
+    QString m_previousVersion;
+
+    // The install in progress is an update check nobody is watching
+    bool m_backgroundUpdate = false;
+    QTimer m_updateTimer;
+
+    // Set when the current install is cancelled or over; each install gets
+    // its own, shared with its worker and any scheduled retry
+    std::shared_ptr<std::atomic_bool> m_installCancelled;
+    QThreadPool m_installPool;
 
     // Widevine metadata from Firefox repository
     QString m_widevineUrl;
     QString m_widevineVersion;
     QString m_widevineHash;
+    QCryptographicHash::Algorithm m_widevineHashAlgorithm = QCryptographicHash::Sha512;
 
     static constexpr const char *FIREFOX_WIDEVINE_JSON =
         "https://raw.githubusercontent.com/mozilla/gecko-dev/master/toolkit/content/gmp-sources/widevinecdm.json";